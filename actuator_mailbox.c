@@ -0,0 +1,61 @@
+#include "actuator_mailbox.h"
+#include <string.h>
+#include "memory_barrier.h"
+
+#define ACTUATOR_MAILBOX_MASK   (ACTUATOR_MAILBOX_SIZE - 1)
+
+
+void actuator_mailbox_init(actuator_mailbox_t * p_mailbox)
+{
+    memset(p_mailbox, 0, sizeof(actuator_mailbox_t));
+}
+
+
+bool actuator_mailbox_put(actuator_mailbox_t * p_mailbox, const actuator_cmd_t * p_cmd)
+{
+    uint8_t head = p_mailbox->head;
+    uint8_t pending;
+
+    if ((uint8_t)(head - p_mailbox->tail) >= ACTUATOR_MAILBOX_SIZE)
+    {
+        p_mailbox->overflow_count++;
+        return false;
+    }
+    p_mailbox->buffer[head & ACTUATOR_MAILBOX_MASK] = *p_cmd;
+    // Publish the command only after it has been written.
+    MEMORY_BARRIER();
+    p_mailbox->head = head + 1;
+
+    pending = (uint8_t)(head + 1 - p_mailbox->tail);
+    if (pending > p_mailbox->high_water)
+    {
+        p_mailbox->high_water = pending;
+    }
+    return true;
+}
+
+
+bool actuator_mailbox_get(actuator_mailbox_t * p_mailbox, actuator_cmd_t * p_cmd)
+{
+    uint8_t tail = p_mailbox->tail;
+
+    if (tail == p_mailbox->head)
+    {
+        return false;
+    }
+    MEMORY_BARRIER();
+    *p_cmd = p_mailbox->buffer[tail & ACTUATOR_MAILBOX_MASK];
+    // Release the slot only after the command has been read.
+    MEMORY_BARRIER();
+    p_mailbox->tail = tail + 1;
+    return true;
+}
+
+
+uint8_t actuator_mailbox_high_water_get(actuator_mailbox_t * p_mailbox)
+{
+    uint8_t high_water = p_mailbox->high_water;
+
+    p_mailbox->high_water = (uint8_t)(p_mailbox->head - p_mailbox->tail);
+    return high_water;
+}
@@ -0,0 +1,96 @@
+/**@file
+ *
+ * @defgroup actuator_mailbox Actuator command mailbox
+ * @{
+ * @brief    Lock-free queue of commands from the BLE event handler to the actuator context.
+ *
+ * @details  The BLE event handler is the only producer of an @ref actuator_mailbox_t and the
+ *           actuator context (the handler that advances the LED and motor patterns) is the only
+ *           consumer, so the fill level, the mixers and the pattern pointers they hold are only
+ *           ever modified by the actuator context and neither side has to disable interrupts.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef ACTUATOR_MAILBOX_H__
+#define ACTUATOR_MAILBOX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ACTUATOR_MAILBOX_SIZE           8                            /**< Number of commands held by the mailbox. Must be a power of two, at most 128. */
+
+/**@brief   Actuator command types. */
+typedef enum
+{
+    ACTUATOR_CMD_VALUE,                                /**< Add a received value to the fill level and flash the LED. */
+    ACTUATOR_CMD_RESET,                                /**< Empty the fill level. */
+    ACTUATOR_CMD_FILL_CONFIG,                          /**< Write the fill level configuration, reply with the active one. */
+    ACTUATOR_CMD_PATTERN_PLAY,                         /**< Play a stored pattern. */
+} actuator_cmd_type_t;
+
+/**@brief   Actuator command. */
+typedef struct
+{
+    uint8_t                  type;                    /**< @ref actuator_cmd_type_t. */
+    union
+    {
+        uint32_t             amount;                  /**< ACTUATOR_CMD_VALUE: fill level units to add. */
+        struct
+        {
+            uint16_t         capacity;                /**< Capacity, in units of received value / 10, 0 to only read the configuration. */
+            uint16_t         decay_per_min;           /**< Drain per minute, in the same units. */
+        } fill_config;                                /**< ACTUATOR_CMD_FILL_CONFIG parameters. */
+        struct
+        {
+            uint8_t          id;                      /**< Pattern ID. */
+            uint8_t          policy;                  /**< @ref anim_policy_t, ANIM_POLICY_COUNT for the default of the actuator. */
+        } pattern;                                    /**< ACTUATOR_CMD_PATTERN_PLAY parameters. */
+    } params;
+} actuator_cmd_t;
+
+/**@brief   Single-producer/single-consumer ring buffer of actuator commands. */
+typedef struct
+{
+    actuator_cmd_t           buffer[ACTUATOR_MAILBOX_SIZE]; /**< Command storage. */
+    volatile uint8_t         head;                    /**< Free-running write index, only modified by the producer. */
+    volatile uint8_t         tail;                    /**< Free-running read index, only modified by the consumer. */
+    volatile uint8_t         high_water;              /**< Largest number of commands pending at once since the last reset. */
+    volatile uint32_t        overflow_count;          /**< Number of commands dropped because the mailbox was full. */
+} actuator_mailbox_t;
+
+/**@brief       Function for initializing an empty mailbox.
+ *
+ * @param[out]  p_mailbox   Mailbox to initialize.
+ */
+void actuator_mailbox_init(actuator_mailbox_t * p_mailbox);
+
+/**@brief       Function for posting a command. Only called by the producer.
+ *
+ * @param[in]   p_mailbox   Mailbox.
+ * @param[in]   p_cmd       Command, copied into the mailbox.
+ *
+ * @return      true if the command was posted, false if the mailbox was full and it was dropped.
+ */
+bool actuator_mailbox_put(actuator_mailbox_t * p_mailbox, const actuator_cmd_t * p_cmd);
+
+/**@brief       Function for taking the oldest command. Only called by the consumer.
+ *
+ * @param[in]   p_mailbox   Mailbox.
+ * @param[out]  p_cmd       Oldest command.
+ *
+ * @return      true if a command was returned, false if the mailbox was empty.
+ */
+bool actuator_mailbox_get(actuator_mailbox_t * p_mailbox, actuator_cmd_t * p_cmd);
+
+/**@brief       Function for getting and restarting the high-water mark. Only called by the producer.
+ *
+ * @param[in]   p_mailbox   Mailbox.
+ *
+ * @return      Largest number of commands pending at once since the last call.
+ */
+uint8_t actuator_mailbox_high_water_get(actuator_mailbox_t * p_mailbox);
+
+#endif // ACTUATOR_MAILBOX_H__
+
+/** @} */
@@ -0,0 +1,72 @@
+#include "adc_filter.h"
+#include <string.h>
+#include "memory_barrier.h"
+
+#define ADC_RING_MASK   (ADC_RING_SIZE - 1)
+
+
+void adc_ring_init(adc_ring_t * p_ring)
+{
+    memset(p_ring, 0, sizeof(adc_ring_t));
+}
+
+
+bool adc_ring_put(adc_ring_t * p_ring, uint16_t sample)
+{
+    uint8_t head = p_ring->head;
+
+    if ((uint8_t)(head - p_ring->tail) >= ADC_RING_SIZE)
+    {
+        p_ring->overflow_count++;
+        return false;
+    }
+    p_ring->buffer[head & ADC_RING_MASK] = sample;
+    // Publish the sample only after it has been written.
+    MEMORY_BARRIER();
+    p_ring->head = head + 1;
+    return true;
+}
+
+
+bool adc_ring_get(adc_ring_t * p_ring, uint16_t * p_sample)
+{
+    uint8_t tail = p_ring->tail;
+
+    if (tail == p_ring->head)
+    {
+        return false;
+    }
+    MEMORY_BARRIER();
+    *p_sample = p_ring->buffer[tail & ADC_RING_MASK];
+    // Release the slot only after the sample has been read.
+    MEMORY_BARRIER();
+    p_ring->tail = tail + 1;
+    return true;
+}
+
+
+void adc_decimator_init(adc_decimator_t * p_dec, uint8_t ratio_log2)
+{
+    if (ratio_log2 > ADC_DECIMATION_MAX_LOG2)
+    {
+        ratio_log2 = ADC_DECIMATION_MAX_LOG2;
+    }
+    p_dec->ratio_log2 = ratio_log2;
+    p_dec->count      = 0;
+    p_dec->sum        = 0;
+}
+
+
+bool adc_decimator_put(adc_decimator_t * p_dec, uint16_t sample, uint16_t * p_output)
+{
+    p_dec->sum += sample;
+    p_dec->count++;
+    if (p_dec->count < (1 << p_dec->ratio_log2))
+    {
+        return false;
+    }
+    *p_output    = (uint16_t)(p_dec->sum >> p_dec->ratio_log2);
+    p_dec->sum   = 0;
+    p_dec->count = 0;
+    return true;
+}
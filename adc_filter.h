@@ -0,0 +1,84 @@
+/**@file
+ *
+ * @defgroup adc_filter ADC sample ring buffer and decimator
+ * @{
+ * @brief    Lock-free sample buffer and oversample-and-decimate stage for the droplet sensor.
+ *
+ * @details  The ADC interrupt is the only producer of an @ref adc_ring_t and the main loop is the
+ *           only consumer, so neither side has to disable interrupts. Raw samples taken from the
+ *           ring are summed by an @ref adc_decimator_t, which outputs one averaged sample for every
+ *           2^ratio_log2 raw samples (a boxcar, i.e. a first order CIC filter).
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef ADC_FILTER_H__
+#define ADC_FILTER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ADC_RING_SIZE                   32                           /**< Number of raw samples held by the ring buffer. Must be a power of two, at most 128. */
+#define ADC_DECIMATION_MAX_LOG2         4                            /**< Largest supported decimation ratio (16x). */
+
+/**@brief   Single-producer/single-consumer ring buffer of raw ADC samples. */
+typedef struct
+{
+    uint16_t                 buffer[ADC_RING_SIZE];   /**< Sample storage. */
+    volatile uint8_t         head;                    /**< Free-running write index, only modified by the producer. */
+    volatile uint8_t         tail;                    /**< Free-running read index, only modified by the consumer. */
+    volatile uint32_t        overflow_count;          /**< Number of samples dropped because the buffer was full. */
+} adc_ring_t;
+
+/**@brief   Boxcar decimator state. */
+typedef struct
+{
+    uint8_t                  ratio_log2;              /**< Decimation ratio as a power of two (0: none, 2: 4x, 4: 16x). */
+    uint8_t                  count;                   /**< Number of samples accumulated in sum. */
+    uint32_t                 sum;                     /**< Sum of the samples of the current block. */
+} adc_decimator_t;
+
+/**@brief       Function for initializing an empty ring buffer.
+ *
+ * @param[out]  p_ring      Ring buffer to initialize.
+ */
+void adc_ring_init(adc_ring_t * p_ring);
+
+/**@brief       Function for adding a sample to the ring buffer. Only called by the producer.
+ *
+ * @param[in]   p_ring      Ring buffer.
+ * @param[in]   sample      Raw ADC sample.
+ *
+ * @return      true if the sample was stored, false if the buffer was full and it was dropped.
+ */
+bool adc_ring_put(adc_ring_t * p_ring, uint16_t sample);
+
+/**@brief       Function for taking the oldest sample from the ring buffer. Only called by the consumer.
+ *
+ * @param[in]   p_ring      Ring buffer.
+ * @param[out]  p_sample    Oldest sample.
+ *
+ * @return      true if a sample was returned, false if the buffer was empty.
+ */
+bool adc_ring_get(adc_ring_t * p_ring, uint16_t * p_sample);
+
+/**@brief       Function for initializing a decimator.
+ *
+ * @param[out]  p_dec       Decimator to initialize.
+ * @param[in]   ratio_log2  Decimation ratio as a power of two, clamped to ADC_DECIMATION_MAX_LOG2.
+ */
+void adc_decimator_init(adc_decimator_t * p_dec, uint8_t ratio_log2);
+
+/**@brief       Function for feeding a raw sample to a decimator.
+ *
+ * @param[in]   p_dec       Decimator.
+ * @param[in]   sample      Raw ADC sample.
+ * @param[out]  p_output    Average of the last 2^ratio_log2 samples, only written when a block completes.
+ *
+ * @return      true if a block was completed and p_output was written.
+ */
+bool adc_decimator_put(adc_decimator_t * p_dec, uint16_t sample, uint16_t * p_output);
+
+#endif // ADC_FILTER_H__
+
+/** @} */
@@ -0,0 +1,40 @@
+#include "adc_scheduler.h"
+
+
+static uint16_t distance(uint16_t a, uint16_t b)
+{
+    return (a > b) ? (a - b) : (b - a);
+}
+
+
+void adc_scheduler_init(adc_scheduler_t * p_sched, const adc_scheduler_config_t * p_config)
+{
+    p_sched->config      = *p_config;
+    p_sched->last_value  = 0;
+    p_sched->quiet_count = 0;
+}
+
+
+void adc_scheduler_sample(adc_scheduler_t * p_sched, uint16_t value, uint16_t threshold)
+{
+    if ((distance(value, threshold) < p_sched->config.near_band) ||
+        (distance(value, p_sched->last_value) >= p_sched->config.change_delta))
+    {
+        p_sched->quiet_count = 0;
+    }
+    else if (p_sched->quiet_count < p_sched->config.quiet_samples)
+    {
+        p_sched->quiet_count++;
+    }
+    p_sched->last_value = value;
+}
+
+
+adc_rate_t adc_scheduler_rate_get(const adc_scheduler_t * p_sched, bool is_active, bool is_connected)
+{
+    if (is_active || (p_sched->quiet_count < p_sched->config.quiet_samples))
+    {
+        return ADC_RATE_FAST;
+    }
+    return is_connected ? ADC_RATE_IDLE : ADC_RATE_DISCONNECTED;
+}
@@ -0,0 +1,73 @@
+/**@file
+ *
+ * @defgroup adc_scheduler ADC sampling rate scheduler
+ * @{
+ * @brief    Chooses the ADC sampling rate from the sensor signal and the application state.
+ *
+ * @details  The scheduler samples fast while the filtered signal is close to the press threshold
+ *           or has just moved, or while the actuators are running, and backs off once it has been
+ *           quiet for a number of samples. It backs off further while no peer is connected. The
+ *           application maps the returned @ref adc_rate_t to a timer interval and restarts its
+ *           sampling timer when it changes.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef ADC_SCHEDULER_H__
+#define ADC_SCHEDULER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief   Sampling rates, from fastest to slowest. */
+typedef enum
+{
+    ADC_RATE_FAST,                                    /**< Signal near the threshold or changing, or LED or motor animation running. */
+    ADC_RATE_IDLE,                                    /**< Connected, signal quiet. */
+    ADC_RATE_DISCONNECTED                             /**< No peer connected, signal quiet. */
+} adc_rate_t;
+
+/**@brief   Scheduler tuning parameters, in filtered ADC units and samples. */
+typedef struct
+{
+    uint16_t                 near_band;               /**< Distance to the threshold below which the signal is considered close to it. */
+    uint16_t                 change_delta;            /**< Sample-to-sample change that counts as signal activity. */
+    uint16_t                 quiet_samples;           /**< Number of quiet samples before backing off from ADC_RATE_FAST. */
+} adc_scheduler_config_t;
+
+/**@brief   Scheduler state. */
+typedef struct
+{
+    adc_scheduler_config_t   config;                  /**< Tuning parameters. */
+    uint16_t                 last_value;              /**< Previous filtered sample. */
+    uint16_t                 quiet_count;             /**< Consecutive quiet samples, saturates at config.quiet_samples. */
+} adc_scheduler_t;
+
+/**@brief       Function for initializing the scheduler. It starts in the fast state.
+ *
+ * @param[out]  p_sched     Scheduler to initialize.
+ * @param[in]   p_config    Tuning parameters.
+ */
+void adc_scheduler_init(adc_scheduler_t * p_sched, const adc_scheduler_config_t * p_config);
+
+/**@brief       Function for feeding a filtered sample to the scheduler.
+ *
+ * @param[in]   p_sched     Scheduler.
+ * @param[in]   value       Filtered ADC sample.
+ * @param[in]   threshold   Current press threshold.
+ */
+void adc_scheduler_sample(adc_scheduler_t * p_sched, uint16_t value, uint16_t threshold);
+
+/**@brief       Function for getting the rate to sample at.
+ *
+ * @param[in]   p_sched       Scheduler.
+ * @param[in]   is_active     true while an LED or motor animation is running.
+ * @param[in]   is_connected  true while a peer is connected.
+ *
+ * @return      Rate to sample at.
+ */
+adc_rate_t adc_scheduler_rate_get(const adc_scheduler_t * p_sched, bool is_active, bool is_connected);
+
+#endif // ADC_SCHEDULER_H__
+
+/** @} */
@@ -0,0 +1,141 @@
+#include "anim_mixer.h"
+#include <stddef.h>
+
+
+/**@brief   Function for combining the main and overlay tracks. */
+static uint8_t mix_get(const anim_mixer_t * p_mixer)
+{
+    uint16_t sum;
+
+    if (!anim_player_is_running(&p_mixer->overlay))
+    {
+        return p_mixer->main.value;
+    }
+    if (p_mixer->blend == ANIM_POLICY_BLEND_ADD)
+    {
+        sum = p_mixer->main.value + p_mixer->overlay.value;
+        return (sum > 0xFF) ? 0xFF : (uint8_t)sum;
+    }
+    return (p_mixer->main.value > p_mixer->overlay.value) ? p_mixer->main.value : p_mixer->overlay.value;
+}
+
+
+/**@brief   Function for starting the next waiting effect on the main track, if any. */
+static void queue_next_start(anim_mixer_t * p_mixer)
+{
+    const anim_effect_t * p_effect;
+
+    if (p_mixer->queue_count == 0)
+    {
+        return;
+    }
+    p_effect = &p_mixer->queue[p_mixer->queue_head];
+    p_mixer->queue_head = (p_mixer->queue_head + 1) % ANIM_MIXER_QUEUE_SIZE;
+    p_mixer->queue_count--;
+    anim_player_start(&p_mixer->main, p_effect->p_keyframes, p_effect->count);
+    p_mixer->p_main_context = p_effect->p_context;
+}
+
+
+void anim_mixer_init(anim_mixer_t * p_mixer, uint8_t value)
+{
+    anim_player_init(&p_mixer->main, value);
+    anim_player_init(&p_mixer->overlay, 0);
+    p_mixer->p_main_context  = NULL;
+    p_mixer->blend           = ANIM_POLICY_BLEND_MAX;
+    p_mixer->queue_head      = 0;
+    p_mixer->queue_count     = 0;
+    p_mixer->value           = value;
+    p_mixer->is_step         = false;
+    p_mixer->coalesced_count = 0;
+}
+
+
+void anim_mixer_submit(anim_mixer_t *          p_mixer,
+                       uint8_t                 policy,
+                       const anim_keyframe_t * p_keyframes,
+                       uint8_t                 count,
+                       const void *            p_context)
+{
+    anim_effect_t * p_effect;
+
+    switch (policy)
+    {
+        case ANIM_POLICY_APPEND:
+            if (!anim_player_is_running(&p_mixer->main) && (p_mixer->queue_count == 0))
+            {
+                anim_player_start(&p_mixer->main, p_keyframes, count);
+                p_mixer->p_main_context = p_context;
+                break;
+            }
+            if (p_mixer->queue_count < ANIM_MIXER_QUEUE_SIZE)
+            {
+                p_mixer->queue_count++;
+            }
+            else
+            {
+                p_mixer->coalesced_count++;
+            }
+            p_effect = &p_mixer->queue[(p_mixer->queue_head + p_mixer->queue_count - 1) % ANIM_MIXER_QUEUE_SIZE];
+            p_effect->p_keyframes = p_keyframes;
+            p_effect->count       = count;
+            p_effect->p_context   = p_context;
+            break;
+
+        case ANIM_POLICY_BLEND_MAX:
+        case ANIM_POLICY_BLEND_ADD:
+            p_mixer->blend = policy;
+            anim_player_init(&p_mixer->overlay, 0);
+            anim_player_start(&p_mixer->overlay, p_keyframes, count);
+            break;
+
+        default:
+            // Continue from the mixed output so that dropping the overlay does not cause a jump.
+            anim_mixer_stop(p_mixer);
+            anim_player_start(&p_mixer->main, p_keyframes, count);
+            p_mixer->p_main_context = p_context;
+            break;
+    }
+}
+
+
+void anim_mixer_stop(anim_mixer_t * p_mixer)
+{
+    anim_player_init(&p_mixer->main, p_mixer->value);
+    anim_player_init(&p_mixer->overlay, 0);
+    p_mixer->p_main_context = NULL;
+    p_mixer->queue_count    = 0;
+}
+
+
+uint8_t anim_mixer_advance(anim_mixer_t * p_mixer, uint32_t elapsed_ticks)
+{
+    bool is_overlay_running = anim_player_is_running(&p_mixer->overlay);
+    bool is_step;
+
+    (void)anim_player_advance(&p_mixer->main, elapsed_ticks);
+    is_step = p_mixer->main.is_step;
+    if (!anim_player_is_running(&p_mixer->main))
+    {
+        // The remainder of the frame is not carried over, the next effect starts on this frame.
+        queue_next_start(p_mixer);
+        (void)anim_player_advance(&p_mixer->main, 0);
+        is_step |= p_mixer->main.is_step;
+    }
+    (void)anim_player_advance(&p_mixer->overlay, elapsed_ticks);
+    is_step |= p_mixer->overlay.is_step;
+    is_step |= is_overlay_running && !anim_player_is_running(&p_mixer->overlay);
+
+    p_mixer->is_step = is_step;
+
+    p_mixer->value = mix_get(p_mixer);
+    return p_mixer->value;
+}
+
+
+bool anim_mixer_is_running(const anim_mixer_t * p_mixer)
+{
+    return anim_player_is_running(&p_mixer->main)    ||
+           anim_player_is_running(&p_mixer->overlay) ||
+           (p_mixer->queue_count > 0);
+}
@@ -0,0 +1,113 @@
+/**@file
+ *
+ * @defgroup anim_mixer Actuator animation mixer
+ * @{
+ * @brief    Combines the effects requested for one actuator into a single output.
+ *
+ * @details  A mixer has a main track, a bounded queue of effects waiting for the main track and an
+ *           overlay track blended onto it. How a new effect is combined with the ones playing is
+ *           chosen per effect with an @ref anim_policy_t. A frame advances two players, a burst of
+ *           effects only ever touches the queue, so the work per frame does not depend on how many
+ *           effects were requested.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef ANIM_MIXER_H__
+#define ANIM_MIXER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "anim_player.h"
+
+#define ANIM_MIXER_QUEUE_SIZE           4                            /**< Effects that can wait for the main track. */
+
+/**@brief   How a new effect is combined with the effects playing. */
+typedef enum
+{
+    ANIM_POLICY_REPLACE,                              /**< Stop everything and play on the main track from the current output. */
+    ANIM_POLICY_APPEND,                               /**< Play on the main track once the effects before it are done. */
+    ANIM_POLICY_BLEND_MAX,                            /**< Play on the overlay track, the output is the larger of both tracks. */
+    ANIM_POLICY_BLEND_ADD,                            /**< Play on the overlay track, the output is the saturated sum of both tracks. */
+    ANIM_POLICY_COUNT
+} anim_policy_t;
+
+/**@brief   A pattern waiting in the queue. */
+typedef struct
+{
+    const anim_keyframe_t *  p_keyframes;
+    uint8_t                  count;
+    const void *             p_context;               /**< Caller data passed along with the effect. */
+} anim_effect_t;
+
+/**@brief   Mixer state. */
+typedef struct
+{
+    anim_player_t            main;                    /**< Main track. */
+    const void *             p_main_context;          /**< Caller data of the effect on the main track, NULL when stopped. */
+    anim_player_t            overlay;                 /**< Overlay track, starts from 0 for every effect. */
+    uint8_t                  blend;                   /**< ANIM_POLICY_BLEND_MAX or ANIM_POLICY_BLEND_ADD, for the overlay. */
+    anim_effect_t            queue[ANIM_MIXER_QUEUE_SIZE]; /**< Effects waiting for the main track. */
+    uint8_t                  queue_head;              /**< Index of the next effect to play. */
+    uint8_t                  queue_count;             /**< Number of waiting effects. */
+    uint8_t                  value;                   /**< Mixed output. */
+    bool                     is_step;                 /**< The last advance went through a step of either track or the end of the overlay. */
+    uint32_t                 coalesced_count;         /**< Appended effects that replaced the last waiting one because the queue was full. */
+} anim_mixer_t;
+
+/**@brief       Function for initializing an idle mixer.
+ *
+ * @param[out]  p_mixer     Mixer to initialize.
+ * @param[in]   value       Initial output value.
+ */
+void anim_mixer_init(anim_mixer_t * p_mixer, uint8_t value);
+
+/**@brief       Function for submitting an effect.
+ *
+ * @details     When the queue is full, an appended effect takes the place of the last waiting one,
+ *              so the most recent request is never lost. The keyframes are referenced, not copied,
+ *              and must stay valid until the effect has been played or the mixer stopped.
+ *
+ * @param[in]   p_mixer     Mixer.
+ * @param[in]   policy      @ref anim_policy_t, unknown values are treated as ANIM_POLICY_REPLACE.
+ * @param[in]   p_keyframes Keyframes of the effect.
+ * @param[in]   count       Number of keyframes.
+ * @param[in]   p_context   Caller data, available in p_main_context while the effect plays on the
+ *                          main track, for example its drive parameters.
+ */
+void anim_mixer_submit(anim_mixer_t *          p_mixer,
+                       uint8_t                 policy,
+                       const anim_keyframe_t * p_keyframes,
+                       uint8_t                 count,
+                       const void *            p_context);
+
+/**@brief       Function for stopping all tracks and emptying the queue, keeping the current output.
+ *
+ * @param[in]   p_mixer     Mixer.
+ */
+void anim_mixer_stop(anim_mixer_t * p_mixer);
+
+/**@brief       Function for advancing the mixer.
+ *
+ * @details     is_step is set when the change of output may contain a jump: a step keyframe on
+ *              either track, or the overlay ending and leaving the main track alone. Progress
+ *              through interpolated segments never sets it, however large the change per advance.
+ *
+ * @param[in]   p_mixer         Mixer.
+ * @param[in]   elapsed_ticks   Time since the previous advance, in player ticks.
+ *
+ * @return      Mixed output value.
+ */
+uint8_t anim_mixer_advance(anim_mixer_t * p_mixer, uint32_t elapsed_ticks);
+
+/**@brief       Function for checking whether any effect is playing or waiting.
+ *
+ * @param[in]   p_mixer     Mixer.
+ *
+ * @return      true while the output may still change.
+ */
+bool anim_mixer_is_running(const anim_mixer_t * p_mixer);
+
+#endif // ANIM_MIXER_H__
+
+/** @} */
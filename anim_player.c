@@ -0,0 +1,128 @@
+#include "anim_player.h"
+
+
+/**@brief   Function for getting the interpolation curve at a segment position.
+ *
+ * @param[in]   interp  Interpolation.
+ * @param[in]   phase   Position in the segment, ANIM_SHAPE_BITS fractional bits.
+ *
+ * @return      Fraction of the distance covered, ANIM_SHAPE_BITS fractional bits.
+ */
+static uint32_t shape_get(uint8_t interp, uint32_t phase)
+{
+    uint32_t square;
+
+    switch (interp)
+    {
+        case ANIM_INTERP_LINEAR:
+            return phase;
+
+        case ANIM_INTERP_EASE:
+            // 3p^2 - 2p^3 = p^2 * (3 - 2p), fits in 32 bits with 15 fractional bits.
+            square = (phase * phase) >> ANIM_SHAPE_BITS;
+            return (square * ((3UL << ANIM_SHAPE_BITS) - 2 * phase)) >> ANIM_SHAPE_BITS;
+
+        default:
+            return 1UL << ANIM_SHAPE_BITS;
+    }
+}
+
+
+/**@brief   Function for starting the segment ending at the current keyframe. */
+static void segment_begin(anim_player_t * p_player)
+{
+    uint32_t duration_ticks = ANIM_MS_TO_TICKS(p_player->p_keyframes[p_player->index].duration_ms);
+
+    p_player->from            = p_player->value;
+    p_player->remaining_ticks = duration_ticks;
+    p_player->duration_ticks  = duration_ticks;
+}
+
+
+/**@brief   Function for computing the output value from the segment progress.
+ *
+ * @details The position is taken from the time into the segment rather than accumulated from a
+ *          truncated rate, so a long segment still ends on its keyframe value. Only called with
+ *          0 < remaining_ticks < duration_ticks.
+ */
+static uint8_t segment_value_get(const anim_player_t * p_player)
+{
+    const anim_keyframe_t * p_keyframe = &p_player->p_keyframes[p_player->index];
+    uint32_t                elapsed    = p_player->duration_ticks - p_player->remaining_ticks;
+    uint32_t                shape;
+
+    // A segment lasts up to 2^21 ticks, so the product needs more than 32 bits.
+    shape = shape_get(p_keyframe->interp, (uint32_t)(((uint64_t)elapsed << ANIM_SHAPE_BITS) / p_player->duration_ticks));
+    if (p_keyframe->value >= p_player->from)
+    {
+        return p_player->from + (((uint32_t)(p_keyframe->value - p_player->from) * shape) >> ANIM_SHAPE_BITS);
+    }
+    return p_player->from - (((uint32_t)(p_player->from - p_keyframe->value) * shape) >> ANIM_SHAPE_BITS);
+}
+
+
+void anim_player_init(anim_player_t * p_player, uint8_t value)
+{
+    p_player->p_keyframes     = 0;
+    p_player->count           = 0;
+    p_player->index           = 0;
+    p_player->is_running      = false;
+    p_player->from            = value;
+    p_player->value           = value;
+    p_player->remaining_ticks = 0;
+    p_player->duration_ticks  = 0;
+    p_player->is_step         = false;
+}
+
+
+void anim_player_start(anim_player_t * p_player, const anim_keyframe_t * p_keyframes, uint8_t count)
+{
+    p_player->p_keyframes = p_keyframes;
+    p_player->count       = count;
+    p_player->index       = 0;
+    p_player->is_running  = (count > 0);
+    if (p_player->is_running)
+    {
+        segment_begin(p_player);
+    }
+}
+
+
+uint8_t anim_player_advance(anim_player_t * p_player, uint32_t elapsed_ticks)
+{
+    p_player->is_step = false;
+    while (p_player->is_running)
+    {
+        const anim_keyframe_t * p_keyframe = &p_player->p_keyframes[p_player->index];
+
+        // Both branches below move a step or zero-duration keyframe straight to its value.
+        if ((p_keyframe->interp == ANIM_INTERP_STEP) || (p_keyframe->duration_ms == 0))
+        {
+            p_player->is_step |= (p_player->value != p_keyframe->value);
+        }
+        if (elapsed_ticks < p_player->remaining_ticks)
+        {
+            p_player->remaining_ticks -= elapsed_ticks;
+            p_player->value            = segment_value_get(p_player);
+            break;
+        }
+
+        // The segment is over, land exactly on the keyframe and carry the rest of the time over.
+        elapsed_ticks    -= p_player->remaining_ticks;
+        p_player->value   = p_keyframe->value;
+        p_player->index++;
+        if (p_player->index >= p_player->count)
+        {
+            p_player->is_running = false;
+            break;
+        }
+        segment_begin(p_player);
+    }
+    return p_player->value;
+}
+
+
+bool anim_player_is_running(const anim_player_t * p_player)
+{
+    return p_player->is_running;
+}
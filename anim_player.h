@@ -0,0 +1,100 @@
+/**@file
+ *
+ * @defgroup anim_player Keyframe animation player
+ * @{
+ * @brief    Plays actuator patterns described as a short list of keyframes.
+ *
+ * @details  Each keyframe gives a duty value, the time to reach it and the interpolation used on
+ *           the way: @ref ANIM_INTERP_STEP jumps to the value and holds it, @ref ANIM_INTERP_LINEAR
+ *           and @ref ANIM_INTERP_EASE move from the previous value to it over the duration. The
+ *           player is advanced by the elapsed time in RTC ticks, so the output does not depend on
+ *           how often it is advanced. Within a segment the position is computed from the time into
+ *           it, so even a 65 s segment reaches its value without a jump at the end. An advance
+ *           costs one 64-bit division and a few multiplications and shifts.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef ANIM_PLAYER_H__
+#define ANIM_PLAYER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ANIM_TICKS_PER_SECOND           32768                        /**< Time base of the player, RTC1 with prescaler 0. */
+#define ANIM_MS_TO_TICKS(MS)            ((uint32_t)(MS) * ANIM_TICKS_PER_SECOND / 1000) /**< Converts a keyframe duration to player ticks. */
+#define ANIM_SHAPE_BITS                 15                           /**< Fractional bits of the interpolation curves. */
+
+/**@brief   Interpolation from the previous value to the keyframe value. */
+typedef enum
+{
+    ANIM_INTERP_STEP,                                 /**< Jump to the value at the start of the segment and hold it. */
+    ANIM_INTERP_LINEAR,                               /**< Constant rate of change. */
+    ANIM_INTERP_EASE,                                 /**< Smoothstep, slow at both ends of the segment. */
+    ANIM_INTERP_COUNT
+} anim_interp_t;
+
+/**@brief   One keyframe, 4 bytes. */
+typedef struct
+{
+    uint16_t                 duration_ms;             /**< Length of the segment ending at this keyframe. */
+    uint8_t                  value;                   /**< Duty value reached at the end of the segment. */
+    uint8_t                  interp;                  /**< @ref anim_interp_t used during the segment. */
+} anim_keyframe_t;
+
+/**@brief   Player state. */
+typedef struct
+{
+    const anim_keyframe_t *  p_keyframes;             /**< Pattern being played. */
+    uint8_t                  count;                   /**< Number of keyframes in the pattern. */
+    uint8_t                  index;                   /**< Keyframe the current segment ends at. */
+    bool                     is_running;              /**< false once the last keyframe has been reached. */
+    uint8_t                  from;                    /**< Value at the start of the current segment. */
+    uint8_t                  value;                   /**< Current output value. */
+    uint32_t                 remaining_ticks;         /**< Time left in the current segment. */
+    uint32_t                 duration_ticks;          /**< Length of the current segment. */
+    bool                     is_step;                 /**< The last advance jumped to an ANIM_INTERP_STEP or zero-duration keyframe. */
+} anim_player_t;
+
+/**@brief       Function for initializing an idle player.
+ *
+ * @param[out]  p_player    Player to initialize.
+ * @param[in]   value       Initial output value.
+ */
+void anim_player_init(anim_player_t * p_player, uint8_t value);
+
+/**@brief       Function for starting a pattern from the current output value.
+ *
+ * @details     The keyframes are referenced, not copied, and must stay valid while the pattern is
+ *              playing. Keyframes with a zero duration are applied immediately.
+ *
+ * @param[in]   p_player    Player.
+ * @param[in]   p_keyframes Keyframes of the pattern.
+ * @param[in]   count       Number of keyframes, 0 stops the player at the current value.
+ */
+void anim_player_start(anim_player_t * p_player, const anim_keyframe_t * p_keyframes, uint8_t count);
+
+/**@brief       Function for advancing the player.
+ *
+ * @details     is_step tells whether the change of output since the previous advance contains a
+ *              jump of the pattern, as opposed to only progress through interpolated segments. It
+ *              depends on the keyframes, not on how often the player is advanced.
+ *
+ * @param[in]   p_player        Player.
+ * @param[in]   elapsed_ticks   Time since the previous advance or start, in player ticks.
+ *
+ * @return      Output value.
+ */
+uint8_t anim_player_advance(anim_player_t * p_player, uint32_t elapsed_ticks);
+
+/**@brief       Function for checking whether a pattern is playing.
+ *
+ * @param[in]   p_player    Player.
+ *
+ * @return      true until the last keyframe has been reached.
+ */
+bool anim_player_is_running(const anim_player_t * p_player);
+
+#endif // ANIM_PLAYER_H__
+
+/** @} */
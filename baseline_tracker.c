@@ -0,0 +1,58 @@
+#include "baseline_tracker.h"
+
+
+void baseline_tracker_init(baseline_tracker_t * p_tracker, uint8_t shift)
+{
+    p_tracker->level        = 0;
+    p_tracker->is_valid     = false;
+    p_tracker->update_count = 0;
+    p_tracker->hold_count   = 0;
+    baseline_tracker_shift_set(p_tracker, shift);
+}
+
+
+void baseline_tracker_shift_set(baseline_tracker_t * p_tracker, uint8_t shift)
+{
+    p_tracker->shift = (shift > BASELINE_SHIFT_MAX) ? BASELINE_SHIFT_MAX : shift;
+}
+
+
+void baseline_tracker_update(baseline_tracker_t * p_tracker, uint16_t value)
+{
+    uint32_t target = (uint32_t)value << BASELINE_FRAC_BITS;
+
+    p_tracker->update_count++;
+    if (!p_tracker->is_valid)
+    {
+        p_tracker->level    = target;
+        p_tracker->is_valid = true;
+        return;
+    }
+    if (target >= p_tracker->level)
+    {
+        p_tracker->level += (target - p_tracker->level) >> p_tracker->shift;
+    }
+    else
+    {
+        p_tracker->level -= (p_tracker->level - target) >> p_tracker->shift;
+    }
+}
+
+
+void baseline_tracker_seed(baseline_tracker_t * p_tracker, uint16_t value)
+{
+    p_tracker->level    = (uint32_t)value << BASELINE_FRAC_BITS;
+    p_tracker->is_valid = true;
+}
+
+
+void baseline_tracker_hold(baseline_tracker_t * p_tracker)
+{
+    p_tracker->hold_count++;
+}
+
+
+uint16_t baseline_tracker_get(const baseline_tracker_t * p_tracker)
+{
+    return (uint16_t)((p_tracker->level + (1 << (BASELINE_FRAC_BITS - 1))) >> BASELINE_FRAC_BITS);
+}
@@ -0,0 +1,79 @@
+/**@file
+ *
+ * @defgroup baseline_tracker Sensor baseline tracker
+ * @{
+ * @brief    Exponentially weighted moving average of the idle sensor level.
+ *
+ * @details  The baseline follows slow drift caused by ambient light and temperature. Each update
+ *           moves it by 1/2^shift of the distance to the new sample, in fixed point with
+ *           BASELINE_FRAC_BITS fractional bits, so an update costs a subtraction and a shift.
+ *           The caller decides which samples belong to the idle level; samples taken during a
+ *           press should be passed to @ref baseline_tracker_hold instead.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef BASELINE_TRACKER_H__
+#define BASELINE_TRACKER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BASELINE_FRAC_BITS              8                            /**< Fractional bits of the fixed point baseline. */
+#define BASELINE_SHIFT_MAX              12                           /**< Largest supported averaging shift. */
+
+/**@brief   Baseline tracker state. */
+typedef struct
+{
+    uint32_t                 level;                   /**< Baseline in fixed point, BASELINE_FRAC_BITS fractional bits. */
+    uint8_t                  shift;                   /**< Averaging shift, the time constant is about 2^shift samples. */
+    bool                     is_valid;                /**< false until the first sample has been seen. */
+    uint32_t                 update_count;            /**< Number of samples that updated the baseline. */
+    uint32_t                 hold_count;              /**< Number of samples for which the baseline was held. */
+} baseline_tracker_t;
+
+/**@brief       Function for initializing the tracker. The first update sets the baseline.
+ *
+ * @param[out]  p_tracker   Tracker to initialize.
+ * @param[in]   shift       Averaging shift, clamped to BASELINE_SHIFT_MAX.
+ */
+void baseline_tracker_init(baseline_tracker_t * p_tracker, uint8_t shift);
+
+/**@brief       Function for changing the averaging shift without losing the baseline.
+ *
+ * @param[in]   p_tracker   Tracker.
+ * @param[in]   shift       Averaging shift, clamped to BASELINE_SHIFT_MAX.
+ */
+void baseline_tracker_shift_set(baseline_tracker_t * p_tracker, uint8_t shift);
+
+/**@brief       Function for moving the baseline towards an idle sample.
+ *
+ * @param[in]   p_tracker   Tracker.
+ * @param[in]   value       Idle sample.
+ */
+void baseline_tracker_update(baseline_tracker_t * p_tracker, uint16_t value);
+
+/**@brief       Function for restarting the baseline from a sample, as the first update does.
+ *
+ * @param[in]   p_tracker   Tracker.
+ * @param[in]   value       New idle level.
+ */
+void baseline_tracker_seed(baseline_tracker_t * p_tracker, uint16_t value);
+
+/**@brief       Function for recording a sample that must not move the baseline.
+ *
+ * @param[in]   p_tracker   Tracker.
+ */
+void baseline_tracker_hold(baseline_tracker_t * p_tracker);
+
+/**@brief       Function for getting the baseline, rounded to the sample resolution.
+ *
+ * @param[in]   p_tracker   Tracker.
+ *
+ * @return      Baseline, 0 if no sample has been seen yet.
+ */
+uint16_t baseline_tracker_get(const baseline_tracker_t * p_tracker);
+
+#endif // BASELINE_TRACKER_H__
+
+/** @} */
@@ -78,6 +78,48 @@ static void on_write(ble_nus_t * p_nus, ble_evt_t * p_ble_evt)
 }
 
 
+/**@brief     Function for handling the @ref BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST event from the S110
+ *            SoftDevice.
+ *
+ * @details   Reads of the Diagnostics characteristic are authorized so the value can be filled in
+ *            by the application at the time of the read.
+ *
+ * @param[in] p_nus     Nordic UART Service structure.
+ * @param[in] p_ble_evt Pointer to the event received from BLE stack.
+ */
+static void on_rw_authorize_request(ble_nus_t * p_nus, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    ble_gatts_rw_authorize_reply_params_t  auth_reply;
+    uint8_t                                data[BLE_NUS_MAX_DIAG_CHAR_LEN];
+    uint16_t                               length;
+    
+    if (
+        (p_auth_req->type != BLE_GATTS_AUTHORIZE_TYPE_READ)
+        ||
+        (p_auth_req->request.read.handle != p_nus->diag_handles.value_handle)
+        ||
+        (p_nus->diag_handler == NULL)
+       )
+    {
+        return;
+    }
+
+    length = p_nus->diag_handler(p_nus, data, sizeof(data));
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+
+    auth_reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    auth_reply.params.read.gatt_status  = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.read.update       = 1;
+    auth_reply.params.read.offset       = 0;
+    auth_reply.params.read.len          = length;
+    auth_reply.params.read.p_data       = data;
+
+    (void)sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle, &auth_reply);
+}
+
+
 /**@brief       Function for adding RX characteristic.
  *
  * @param[in]   p_nus        Nordic UART Service structure.
@@ -192,6 +234,57 @@ static uint32_t tx_char_add(ble_nus_t * p_nus, const ble_nus_init_t * p_nus_init
 }
 
 
+/**@brief       Function for adding Diagnostics characteristic.
+ *
+ * @param[in]   p_nus        Nordic UART Service structure.
+ * @param[in]   p_nus_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t diag_char_add(ble_nus_t * p_nus, const ble_nus_init_t * p_nus_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    
+    memset(&char_md, 0, sizeof(char_md));
+    
+    char_md.char_props.read             = 1;
+    char_md.p_char_user_desc            = NULL;
+    char_md.p_char_pf                   = NULL;
+    char_md.p_user_desc_md              = NULL;
+    char_md.p_cccd_md                   = NULL;
+    char_md.p_sccd_md                   = NULL;
+    
+    ble_uuid.type                       = p_nus->uuid_type;
+    ble_uuid.uuid                       = BLE_UUID_NUS_DIAG_CHARACTERISTIC;
+    
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    
+    attr_md.vloc                        = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth                     = 1;
+    attr_md.wr_auth                     = 0;
+    attr_md.vlen                        = 1;
+    
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid              = &ble_uuid;
+    attr_char_value.p_attr_md           = &attr_md;
+    attr_char_value.init_len            = 0;
+    attr_char_value.init_offs           = 0;
+    attr_char_value.max_len             = BLE_NUS_MAX_DIAG_CHAR_LEN;
+    
+    return sd_ble_gatts_characteristic_add(p_nus->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_nus->diag_handles);
+}
+
+
 void ble_nus_on_ble_evt(ble_nus_t * p_nus, ble_evt_t * p_ble_evt)
 {
     if ((p_nus == NULL) || (p_ble_evt == NULL))
@@ -213,6 +306,10 @@ void ble_nus_on_ble_evt(ble_nus_t * p_nus, ble_evt_t * p_ble_evt)
             on_write(p_nus, p_ble_evt);
             break;
 
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+            on_rw_authorize_request(p_nus, p_ble_evt);
+            break;
+
         default:
             // No implementation needed.
             break;
@@ -234,6 +331,7 @@ uint32_t ble_nus_init(ble_nus_t * p_nus, const ble_nus_init_t * p_nus_init)
     // Initialize service structure.
     p_nus->conn_handle              = BLE_CONN_HANDLE_INVALID;
     p_nus->data_handler             = p_nus_init->data_handler;
+    p_nus->diag_handler             = p_nus_init->diag_handler;
     p_nus->is_notification_enabled  = false;
     
 
@@ -272,6 +370,16 @@ uint32_t ble_nus_init(ble_nus_t * p_nus, const ble_nus_init_t * p_nus_init)
     {
         return err_code;
     }
+
+    // Add Diagnostics Characteristic.
+    if (p_nus_init->diag_handler != NULL)
+    {
+        err_code = diag_char_add(p_nus, p_nus_init);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
     
     return NRF_SUCCESS;
 }
@@ -40,11 +40,13 @@
 #define BLE_UUID_NUS_SERVICE            0x0001                       /**< The UUID of the Nordic UART Service. */
 #define BLE_UUID_NUS_TX_CHARACTERISTIC  0x0002                       /**< The UUID of the TX Characteristic. */
 #define BLE_UUID_NUS_RX_CHARACTERISTIC  0x0003                       /**< The UUID of the RX Characteristic. */
+#define BLE_UUID_NUS_DIAG_CHARACTERISTIC 0x0004                      /**< The UUID of the Diagnostics Characteristic. */
 
 #define BLE_NUS_MAX_DATA_LEN            (GATT_MTU_SIZE_DEFAULT - 3)  /**< Maximum length of data (in bytes) that can be transmitted by the Nordic UART service module to the peer. */
 
 #define BLE_NUS_MAX_RX_CHAR_LEN         BLE_NUS_MAX_DATA_LEN         /**< Maximum length of the RX Characteristic (in bytes). */
 #define BLE_NUS_MAX_TX_CHAR_LEN         20                           /**< Maximum length of the TX Characteristic (in bytes). */
+#define BLE_NUS_MAX_DIAG_CHAR_LEN       BLE_NUS_MAX_DATA_LEN         /**< Maximum length of the Diagnostics Characteristic (in bytes). */
 
 // Forward declaration of the ble_nus_t type. 
 typedef struct ble_nus_s ble_nus_t;
@@ -52,6 +54,9 @@ typedef struct ble_nus_s ble_nus_t;
 /**@brief Nordic UART Service event handler type. */
 typedef void (*ble_nus_data_handler_t) (ble_nus_t * p_nus, uint8_t * data, uint16_t length);
 
+/**@brief Diagnostics read handler type. Fills data with at most max_length bytes and returns the length used. */
+typedef uint16_t (*ble_nus_diag_handler_t) (ble_nus_t * p_nus, uint8_t * data, uint16_t max_length);
+
 /**@brief   Nordic UART Service init structure.
  *
  * @details This structure contains the initialization information for the service. The application
@@ -61,6 +66,7 @@ typedef void (*ble_nus_data_handler_t) (ble_nus_t * p_nus, uint8_t * data, uint1
 typedef struct
 {
     ble_nus_data_handler_t   data_handler;            /**< Event handler to be called for handling received data. */
+    ble_nus_diag_handler_t   diag_handler;            /**< Handler to be called for filling in the Diagnostics Characteristic on each read. NULL to leave the characteristic out. */
 } ble_nus_init_t;
 
 /**@brief   Nordic UART Service structure.
@@ -73,9 +79,11 @@ typedef struct ble_nus_s
     uint16_t                 service_handle;          /**< Handle of Nordic UART Service (as provided by the S110 SoftDevice). */
     ble_gatts_char_handles_t tx_handles;              /**< Handles related to the TX characteristic. (as provided by the S110 SoftDevice)*/
     ble_gatts_char_handles_t rx_handles;              /**< Handles related to the RX characteristic. (as provided by the S110 SoftDevice)*/
+    ble_gatts_char_handles_t diag_handles;            /**< Handles related to the Diagnostics characteristic. (as provided by the S110 SoftDevice)*/
     uint16_t                 conn_handle;             /**< Handle of the current connection (as provided by the S110 SoftDevice). This will be BLE_CONN_HANDLE_INVALID if not in a connection. */
     bool                     is_notification_enabled; /**< Variable to indicate if the peer has enabled notification of the RX characteristic.*/
     ble_nus_data_handler_t   data_handler;            /**< Event handler to be called for handling received data. */
+    ble_nus_diag_handler_t   diag_handler;            /**< Handler to be called for filling in the Diagnostics Characteristic. */
 } ble_nus_t;
 
 /**@brief       Function for initializing the Nordic UART Service.
@@ -0,0 +1,67 @@
+#include "energy_stats.h"
+#include <string.h>
+
+
+static uint32_t ticks_diff(uint32_t later, uint32_t earlier)
+{
+    return (later - earlier) & ENERGY_STATS_TICK_MASK;
+}
+
+
+void energy_stats_init(energy_stats_t * p_stats, uint32_t now)
+{
+    uint8_t running_mask = p_stats->running_mask;
+
+    memset(p_stats, 0, sizeof(energy_stats_t));
+    p_stats->last_update_ticks = now;
+
+    // Subsystems that are running keep running, their interval restarts now.
+    p_stats->running_mask = running_mask;
+    for (uint8_t id = 0; id < ENERGY_COUNT; id++)
+    {
+        p_stats->start_ticks[id] = now;
+    }
+}
+
+
+void energy_stats_start(energy_stats_t * p_stats, energy_subsystem_t id, uint32_t now)
+{
+    if (p_stats->running_mask & (1 << id))
+    {
+        return;
+    }
+    p_stats->running_mask   |= (1 << id);
+    p_stats->start_ticks[id] = now;
+}
+
+
+void energy_stats_stop(energy_stats_t * p_stats, energy_subsystem_t id, uint32_t now)
+{
+    if (!(p_stats->running_mask & (1 << id)))
+    {
+        return;
+    }
+    p_stats->running_mask    &= ~(1 << id);
+    p_stats->total_ticks[id] += ticks_diff(now, p_stats->start_ticks[id]);
+}
+
+
+void energy_stats_add(energy_stats_t * p_stats, energy_subsystem_t id, uint32_t ticks)
+{
+    p_stats->total_ticks[id] += ticks;
+}
+
+
+void energy_stats_update(energy_stats_t * p_stats, uint32_t now)
+{
+    for (uint8_t id = 0; id < ENERGY_COUNT; id++)
+    {
+        if (p_stats->running_mask & (1 << id))
+        {
+            p_stats->total_ticks[id] += ticks_diff(now, p_stats->start_ticks[id]);
+            p_stats->start_ticks[id]  = now;
+        }
+    }
+    p_stats->elapsed_ticks     += ticks_diff(now, p_stats->last_update_ticks);
+    p_stats->last_update_ticks  = now;
+}
@@ -0,0 +1,86 @@
+/**@file
+ *
+ * @defgroup energy_stats Per-subsystem on-time accounting
+ * @{
+ * @brief    Accumulates the RTC ticks during which each subsystem keeps power-hungry resources on.
+ *
+ * @details  Each subsystem is started and stopped with RTC timestamps, or has measured durations
+ *           added directly. Intervals are taken modulo the 24-bit RTC counter, so
+ *           @ref energy_stats_update must be called at least once per RTC wrap (512 s at 32768 Hz)
+ *           to fold running intervals into the totals. Totals wrap after 2^32 ticks (36 hours).
+ *
+ *           The functions are not reentrant. The caller must make sure that calls from different
+ *           interrupt priorities do not interleave.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef ENERGY_STATS_H__
+#define ENERGY_STATS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ENERGY_STATS_TICK_MASK          0x00FFFFFF                   /**< Width of the RTC counter the timestamps come from. */
+
+/**@brief   Accounted subsystems. */
+typedef enum
+{
+    ENERGY_HFCLK,                                     /**< External crystal held by the application. */
+    ENERGY_CPU,                                       /**< CPU awake: all the time outside sleep, interrupt handlers included, measured from the main loop only. */
+    ENERGY_PWM,                                       /**< PWM timer running. */
+    ENERGY_ADC,                                       /**< ADC converting. */
+    ENERGY_COUNT
+} energy_subsystem_t;
+
+/**@brief   Accounting state. */
+typedef struct
+{
+    uint32_t                 total_ticks[ENERGY_COUNT];   /**< Accumulated on-time per subsystem. */
+    uint32_t                 start_ticks[ENERGY_COUNT];   /**< Start of the running interval per subsystem. */
+    uint8_t                  running_mask;                /**< Bit mask of the running subsystems. */
+    uint32_t                 elapsed_ticks;               /**< Time covered by the totals. */
+    uint32_t                 last_update_ticks;           /**< Timestamp of the last @ref energy_stats_update. */
+} energy_stats_t;
+
+/**@brief       Function for clearing all totals.
+ *
+ * @param[out]  p_stats     Accounting state.
+ * @param[in]   now         Current RTC timestamp.
+ */
+void energy_stats_init(energy_stats_t * p_stats, uint32_t now);
+
+/**@brief       Function for marking a subsystem as running. Does nothing if it already runs.
+ *
+ * @param[in]   p_stats     Accounting state.
+ * @param[in]   id          Subsystem.
+ * @param[in]   now         Current RTC timestamp.
+ */
+void energy_stats_start(energy_stats_t * p_stats, energy_subsystem_t id, uint32_t now);
+
+/**@brief       Function for marking a subsystem as stopped. Does nothing if it is not running.
+ *
+ * @param[in]   p_stats     Accounting state.
+ * @param[in]   id          Subsystem.
+ * @param[in]   now         Current RTC timestamp.
+ */
+void energy_stats_stop(energy_stats_t * p_stats, energy_subsystem_t id, uint32_t now);
+
+/**@brief       Function for adding a measured duration to a subsystem.
+ *
+ * @param[in]   p_stats     Accounting state.
+ * @param[in]   id          Subsystem.
+ * @param[in]   ticks       Duration.
+ */
+void energy_stats_add(energy_stats_t * p_stats, energy_subsystem_t id, uint32_t ticks);
+
+/**@brief       Function for folding running intervals and the elapsed time into the totals.
+ *
+ * @param[in]   p_stats     Accounting state.
+ * @param[in]   now         Current RTC timestamp.
+ */
+void energy_stats_update(energy_stats_t * p_stats, uint32_t now);
+
+#endif // ENERGY_STATS_H__
+
+/** @} */
@@ -0,0 +1,80 @@
+#include "evt_queue.h"
+#include <string.h>
+#include "memory_barrier.h"
+
+#define EVT_QUEUE_MASK          (EVT_QUEUE_SIZE - 1)
+
+
+/**@brief   Function for getting the entry at a free-running index. */
+static evt_queue_entry_t * entry_get(const evt_queue_t * p_queue, uint8_t index)
+{
+    return (evt_queue_entry_t *)&p_queue->p_buffer[(index & EVT_QUEUE_MASK) * p_queue->entry_words];
+}
+
+
+void evt_queue_init(evt_queue_t * p_queue, uint32_t * p_buffer, uint16_t data_size)
+{
+    memset(p_queue, 0, sizeof(evt_queue_t));
+    p_queue->p_buffer    = p_buffer;
+    p_queue->data_size   = data_size;
+    p_queue->entry_words = EVT_QUEUE_ENTRY_WORDS(data_size);
+}
+
+
+bool evt_queue_put(evt_queue_t * p_queue, const void * p_data, uint16_t size, evt_queue_handler_t handler)
+{
+    uint8_t             head = p_queue->head;
+    uint8_t             pending;
+    evt_queue_entry_t * p_entry;
+
+    if (((uint8_t)(head - p_queue->tail) >= EVT_QUEUE_SIZE) || (size > p_queue->data_size))
+    {
+        p_queue->overflow_count++;
+        return false;
+    }
+    p_entry = entry_get(p_queue, head);
+    p_entry->handler = handler;
+    p_entry->size    = size;
+    if (size > 0)
+    {
+        memcpy(p_entry->data, p_data, size);
+    }
+    // Publish the event only after it has been written.
+    MEMORY_BARRIER();
+    p_queue->head = head + 1;
+
+    pending = (uint8_t)(head + 1 - p_queue->tail);
+    if (pending > p_queue->high_water)
+    {
+        p_queue->high_water = pending;
+    }
+    return true;
+}
+
+
+void evt_queue_execute(evt_queue_t * p_queue)
+{
+    uint8_t             tail = p_queue->tail;
+    evt_queue_entry_t * p_entry;
+
+    while (tail != p_queue->head)
+    {
+        MEMORY_BARRIER();
+        // The entry stays owned by the consumer until its handler has returned, so it is not copied.
+        p_entry = entry_get(p_queue, tail);
+        p_entry->handler(p_entry->data, p_entry->size);
+        MEMORY_BARRIER();
+        tail++;
+        p_queue->tail = tail;
+    }
+}
+
+
+uint8_t evt_queue_high_water_get(evt_queue_t * p_queue)
+{
+    uint8_t high_water = p_queue->high_water;
+
+    // Restart from the events pending now, a producer updating it meanwhile only raises it again.
+    p_queue->high_water = (uint8_t)(p_queue->head - p_queue->tail);
+    return high_water;
+}
@@ -0,0 +1,99 @@
+/**@file
+ *
+ * @defgroup evt_queue Main loop event queue
+ * @{
+ * @brief    Fixed-size queue of events deferred from interrupt handlers to the main loop.
+ *
+ * @details  Like the SDK app_scheduler, an event is a small block of data copied into the queue
+ *           together with the handler that processes it, and the main loop runs the handlers in
+ *           order. All producers must run at the same interrupt priority, so they never interrupt
+ *           each other, and the main loop is the only consumer, so neither side has to disable
+ *           interrupts. The largest number of events ever pending at once is kept as a high-water
+ *           mark for sizing the queue.
+ *
+ *           As with APP_SCHED_INIT, the application provides the storage with
+ *           @ref EVT_QUEUE_BUF_WORDS, so the slots are sized from its largest event, for example
+ *           BLE_STACK_EVT_MSG_BUF_SIZE, and not from a guess in this module.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef EVT_QUEUE_H__
+#define EVT_QUEUE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EVT_QUEUE_SIZE                  8                            /**< Number of events held by the queue. Must be a power of two, at most 128. */
+
+/**@brief   Event handler type.
+ *
+ * @param[in]   p_data      Event data, word aligned. Only valid until the handler returns.
+ * @param[in]   size        Size of the event data.
+ */
+typedef void (*evt_queue_handler_t)(void * p_data, uint16_t size);
+
+/**@brief   Queued event, followed by its data. */
+typedef struct
+{
+    evt_queue_handler_t      handler;                 /**< Handler of the event. */
+    uint16_t                 size;                    /**< Size of the event data. */
+    uint32_t                 data[];                  /**< Event data, word aligned so it can hold any event structure. */
+} evt_queue_entry_t;
+
+/**@brief   Words taken by one entry holding up to DATA_SIZE bytes of event data. */
+#define EVT_QUEUE_ENTRY_WORDS(DATA_SIZE) ((sizeof(evt_queue_entry_t) + (DATA_SIZE) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+/**@brief   Size of the storage for a queue of events of up to DATA_SIZE bytes, in words. */
+#define EVT_QUEUE_BUF_WORDS(DATA_SIZE)  (EVT_QUEUE_SIZE * EVT_QUEUE_ENTRY_WORDS(DATA_SIZE))
+
+/**@brief   Single-consumer event queue. */
+typedef struct
+{
+    uint32_t *               p_buffer;                /**< Event storage, EVT_QUEUE_SIZE entries of entry_words words. */
+    uint16_t                 data_size;               /**< Largest event data, in bytes. */
+    uint16_t                 entry_words;             /**< Size of one entry, in words. */
+    volatile uint8_t         head;                    /**< Free-running write index, only modified by the producers. */
+    volatile uint8_t         tail;                    /**< Free-running read index, only modified by the consumer. */
+    volatile uint8_t         high_water;              /**< Largest number of events pending at once since the last reset. */
+    volatile uint32_t        overflow_count;          /**< Number of events dropped because the queue was full or they were too large. */
+} evt_queue_t;
+
+/**@brief       Function for initializing an empty queue.
+ *
+ * @param[out]  p_queue     Queue to initialize.
+ * @param[in]   p_buffer    Event storage of EVT_QUEUE_BUF_WORDS(data_size) words.
+ * @param[in]   data_size   Largest event data, in bytes.
+ */
+void evt_queue_init(evt_queue_t * p_queue, uint32_t * p_buffer, uint16_t data_size);
+
+/**@brief       Function for queueing an event. Only called by the producers.
+ *
+ * @param[in]   p_queue     Queue.
+ * @param[in]   p_data      Event data, copied into the queue. May be NULL if size is 0.
+ * @param[in]   size        Size of the event data, at most the data_size of the queue.
+ * @param[in]   handler     Handler to run the event with.
+ *
+ * @return      true if the event was queued, false if the queue was full or the event too large
+ *              and it was dropped.
+ */
+bool evt_queue_put(evt_queue_t * p_queue, const void * p_data, uint16_t size, evt_queue_handler_t handler);
+
+/**@brief       Function for running the handlers of all pending events, including the ones queued
+ *              while they run. Only called by the consumer.
+ *
+ * @param[in]   p_queue     Queue.
+ */
+void evt_queue_execute(evt_queue_t * p_queue);
+
+/**@brief       Function for getting and restarting the high-water mark.
+ *
+ * @param[in]   p_queue     Queue.
+ *
+ * @return      Largest number of events pending at once since the last call.
+ */
+uint8_t evt_queue_high_water_get(evt_queue_t * p_queue);
+
+#endif // EVT_QUEUE_H__
+
+/** @} */
@@ -0,0 +1,158 @@
+#include "fill_level.h"
+
+#define TICKS_FRAC_MASK                 ((1UL << FILL_LEVEL_TICKS_LOG2) - 1)
+#define MS_TO_TICKS(MS)                 (((MS) << 5) + (((MS) * 3146) >> 12)) /**< 32 + 0.768 ticks per ms, 2 ppm high, for MS up to MS_MAX. */
+#define MS_MAX                          511990                       /**< Just under one RTC wrap, so that MS_TO_TICKS stays within FILL_LEVEL_TICK_MASK. */
+
+
+/**@brief   Function for taking the parameters, clamped to the ranges the 32-bit arithmetic allows.
+ *
+ * @details The scale factor is divided out here, once per configuration, so that fill_level_scale
+ *          is a multiplication.
+ */
+static void config_apply(fill_level_t * p_fill, const fill_level_config_t * p_config)
+{
+    p_fill->config = *p_config;
+    if (p_fill->config.capacity > FILL_LEVEL_CAPACITY_MAX)
+    {
+        p_fill->config.capacity = FILL_LEVEL_CAPACITY_MAX;
+    }
+    if (p_fill->config.decay_rate > FILL_LEVEL_DECAY_RATE_MAX)
+    {
+        p_fill->config.decay_rate = FILL_LEVEL_DECAY_RATE_MAX;
+    }
+    // 255 << 24 fits in 32 bits, and level * scale_factor < 255 << 24 for any level below the capacity.
+    p_fill->scale_factor = (255UL << FILL_LEVEL_SCALE_BITS) / p_fill->config.capacity;
+}
+
+
+/**@brief   Function for computing the drain over a time.
+ *
+ * @details elapsed_ticks * decay_rate can exceed 32 bits, so the whole seconds and the sub-second
+ *          part of the time are multiplied separately, and the rate is split the same way for the
+ *          sub-second part. With elapsed_ticks below 2^24 and the rate below 2^22 no product
+ *          overflows.
+ *
+ * @param[in]       decay_rate      Drain per second, fixed point.
+ * @param[in]       elapsed_ticks   Time, at most FILL_LEVEL_TICK_MASK.
+ * @param[in,out]   p_residual      Sub-unit drain carried over, in 2^-FILL_LEVEL_TICKS_LOG2 units.
+ *
+ * @return      Drain, fixed point.
+ */
+static uint32_t drain_get(uint32_t decay_rate, uint32_t elapsed_ticks, uint32_t * p_residual)
+{
+    uint32_t seconds  = elapsed_ticks >> FILL_LEVEL_TICKS_LOG2;
+    uint32_t fraction = elapsed_ticks & TICKS_FRAC_MASK;
+    uint32_t partial;
+
+    partial     = fraction * (decay_rate & TICKS_FRAC_MASK) + *p_residual;
+    *p_residual = partial & TICKS_FRAC_MASK;
+    return seconds * decay_rate + fraction * (decay_rate >> FILL_LEVEL_TICKS_LOG2) + (partial >> FILL_LEVEL_TICKS_LOG2);
+}
+
+
+void fill_level_init(fill_level_t * p_fill, const fill_level_config_t * p_config, uint32_t now_ticks)
+{
+    config_apply(p_fill, p_config);
+    p_fill->level      = 0;
+    p_fill->residual   = 0;
+    p_fill->last_ticks = now_ticks;
+}
+
+
+void fill_level_config_set(fill_level_t * p_fill, const fill_level_config_t * p_config, uint32_t now_ticks)
+{
+    (void)fill_level_update(p_fill, now_ticks);
+    config_apply(p_fill, p_config);
+    if (p_fill->level > p_fill->config.capacity)
+    {
+        p_fill->level = p_fill->config.capacity;
+    }
+}
+
+
+uint32_t fill_level_update(fill_level_t * p_fill, uint32_t now_ticks)
+{
+    uint32_t elapsed_ticks = (now_ticks - p_fill->last_ticks) & FILL_LEVEL_TICK_MASK;
+    uint32_t drain;
+
+    p_fill->last_ticks = now_ticks;
+    if (p_fill->level == 0)
+    {
+        p_fill->residual = 0;
+        return 0;
+    }
+
+    drain = drain_get(p_fill->config.decay_rate, elapsed_ticks, &p_fill->residual);
+    p_fill->level = (drain >= p_fill->level) ? 0 : (p_fill->level - drain);
+    return p_fill->level;
+}
+
+
+uint32_t fill_level_add(fill_level_t * p_fill, uint32_t amount, uint32_t now_ticks)
+{
+    (void)fill_level_update(p_fill, now_ticks);
+    if (amount >= p_fill->config.capacity - p_fill->level)
+    {
+        p_fill->level = p_fill->config.capacity;
+    }
+    else
+    {
+        p_fill->level += amount;
+    }
+    return p_fill->level;
+}
+
+
+void fill_level_reset(fill_level_t * p_fill, uint32_t now_ticks)
+{
+    p_fill->level      = 0;
+    p_fill->residual   = 0;
+    p_fill->last_ticks = now_ticks;
+}
+
+
+uint32_t fill_level_predict(const fill_level_t * p_fill, uint32_t ms)
+{
+    uint32_t residual = p_fill->residual;
+    uint32_t drain;
+
+    ms    = (ms > MS_MAX) ? MS_MAX : ms;
+    drain = drain_get(p_fill->config.decay_rate, MS_TO_TICKS(ms), &residual);
+    return (drain >= p_fill->level) ? 0 : (p_fill->level - drain);
+}
+
+
+uint32_t fill_level_ms_to_empty(const fill_level_t * p_fill)
+{
+    uint32_t seconds;
+    uint32_t remainder;
+
+    if (p_fill->level == 0)
+    {
+        return 0;
+    }
+    if (p_fill->config.decay_rate == 0)
+    {
+        return 0xFFFFFFFF;
+    }
+    // Whole seconds first, so that only the remainder is multiplied by 1000: it is below the
+    // rate, so below 2^22, and the product fits in 32 bits.
+    seconds   = p_fill->level / p_fill->config.decay_rate;
+    remainder = p_fill->level % p_fill->config.decay_rate;
+    if (seconds >= 0xFFFFFFFF / 1000)
+    {
+        return 0xFFFFFFFF;
+    }
+    return seconds * 1000 + (remainder * 1000 + p_fill->config.decay_rate - 1) / p_fill->config.decay_rate;
+}
+
+
+uint8_t fill_level_scale(const fill_level_t * p_fill, uint32_t level)
+{
+    if (level >= p_fill->config.capacity)
+    {
+        return 255;
+    }
+    return (uint8_t)((level * p_fill->scale_factor) >> FILL_LEVEL_SCALE_BITS);
+}
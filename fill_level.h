@@ -0,0 +1,124 @@
+/**@file
+ *
+ * @defgroup fill_level Leaky bucket fill level
+ * @{
+ * @brief    Fill level that received amounts add to and that drains at a constant rate.
+ *
+ * @details  The decay is not stepped by a timer. Every call that needs the level first drains it
+ *           by the time elapsed since the previous call, using RTC timestamps, and keeps the
+ *           sub-unit remainder so that frequent calls lose nothing. The level and the capacity are
+ *           in fixed point with FILL_LEVEL_FRAC_BITS fractional bits.
+ *
+ *           Intervals are taken modulo the 24-bit RTC counter, so the level must be updated at least
+ *           once per RTC wrap (512 s at 32768 Hz) while it is not empty.
+ *
+ *           All arithmetic is in 32 bits with no division on the update, predict and scale paths,
+ *           the Cortex-M0 has no divider. This is what bounds the capacity and the decay rate, larger
+ *           values are clamped.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef FILL_LEVEL_H__
+#define FILL_LEVEL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FILL_LEVEL_FRAC_BITS            8                            /**< Fractional bits of the level and capacity. */
+#define FILL_LEVEL_TICK_MASK            0x00FFFFFF                   /**< Width of the RTC counter the timestamps come from. */
+#define FILL_LEVEL_TICKS_LOG2           15                           /**< RTC ticks per second as a power of two, 32768 Hz. */
+#define FILL_LEVEL_CAPACITY_MAX         0x00FFFFFF                   /**< Largest capacity, larger ones are clamped to it. */
+#define FILL_LEVEL_DECAY_RATE_MAX       0x003FFFFF                   /**< Largest decay rate, larger ones are clamped to it. */
+#define FILL_LEVEL_SCALE_BITS           24                           /**< Fractional bits of fill_level_t.scale_factor. */
+
+/**@brief   Bucket parameters. */
+typedef struct
+{
+    uint32_t                 capacity;                /**< Largest level, fixed point. Must not be 0, at most FILL_LEVEL_CAPACITY_MAX. */
+    uint32_t                 decay_rate;              /**< Drain per second, fixed point, at most FILL_LEVEL_DECAY_RATE_MAX. 0 disables the decay. */
+} fill_level_config_t;
+
+/**@brief   Bucket state. */
+typedef struct
+{
+    fill_level_config_t      config;                  /**< Parameters. */
+    uint32_t                 level;                   /**< Level at last_ticks, fixed point. */
+    uint32_t                 residual;                /**< Drain not yet taken from the level, in 2^-FILL_LEVEL_TICKS_LOG2 units. */
+    uint32_t                 last_ticks;              /**< Timestamp the level was last brought up to date. */
+    uint32_t                 scale_factor;            /**< 255 / capacity with FILL_LEVEL_SCALE_BITS fractional bits, for fill_level_scale. */
+} fill_level_t;
+
+/**@brief       Function for initializing an empty bucket.
+ *
+ * @param[out]  p_fill      Bucket.
+ * @param[in]   p_config    Parameters.
+ * @param[in]   now_ticks   Current RTC timestamp.
+ */
+void fill_level_init(fill_level_t * p_fill, const fill_level_config_t * p_config, uint32_t now_ticks);
+
+/**@brief       Function for changing the parameters, draining at the old rate up to now first.
+ *
+ * @details     The level is clamped to the new capacity.
+ *
+ * @param[in]   p_fill      Bucket.
+ * @param[in]   p_config    Parameters.
+ * @param[in]   now_ticks   Current RTC timestamp.
+ */
+void fill_level_config_set(fill_level_t * p_fill, const fill_level_config_t * p_config, uint32_t now_ticks);
+
+/**@brief       Function for bringing the level up to date.
+ *
+ * @param[in]   p_fill      Bucket.
+ * @param[in]   now_ticks   Current RTC timestamp.
+ *
+ * @return      Level, fixed point.
+ */
+uint32_t fill_level_update(fill_level_t * p_fill, uint32_t now_ticks);
+
+/**@brief       Function for adding an amount, saturating at the capacity.
+ *
+ * @param[in]   p_fill      Bucket.
+ * @param[in]   amount      Amount, fixed point.
+ * @param[in]   now_ticks   Current RTC timestamp.
+ *
+ * @return      Level, fixed point.
+ */
+uint32_t fill_level_add(fill_level_t * p_fill, uint32_t amount, uint32_t now_ticks);
+
+/**@brief       Function for emptying the bucket.
+ *
+ * @param[in]   p_fill      Bucket.
+ * @param[in]   now_ticks   Current RTC timestamp.
+ */
+void fill_level_reset(fill_level_t * p_fill, uint32_t now_ticks);
+
+/**@brief       Function for predicting the level some time after the last update.
+ *
+ * @param[in]   p_fill      Bucket.
+ * @param[in]   ms          Time after the last update, longer than one RTC wrap counts as one wrap.
+ *
+ * @return      Level, fixed point.
+ */
+uint32_t fill_level_predict(const fill_level_t * p_fill, uint32_t ms);
+
+/**@brief       Function for getting the time until the bucket is empty, from the last update.
+ *
+ * @param[in]   p_fill      Bucket.
+ *
+ * @return      Time in ms, 0xFFFFFFFF if the bucket is not empty and does not decay.
+ */
+uint32_t fill_level_ms_to_empty(const fill_level_t * p_fill);
+
+/**@brief       Function for scaling a level to 0-255 of the capacity.
+ *
+ * @param[in]   p_fill      Bucket.
+ * @param[in]   level       Level, fixed point.
+ *
+ * @return      255 * level / capacity, rounded down, within 1 of the exact quotient.
+ */
+uint8_t fill_level_scale(const fill_level_t * p_fill, uint32_t level);
+
+#endif // FILL_LEVEL_H__
+
+/** @} */
@@ -0,0 +1,10 @@
+#include "led_curve.h"
+
+#define LED_CURVE_4(B)                  LED_CURVE_VALUE(B), LED_CURVE_VALUE((B) + 1), LED_CURVE_VALUE((B) + 2), LED_CURVE_VALUE((B) + 3)
+#define LED_CURVE_16(B)                 LED_CURVE_4(B), LED_CURVE_4((B) + 4), LED_CURVE_4((B) + 8), LED_CURVE_4((B) + 12)
+#define LED_CURVE_64(B)                 LED_CURVE_16(B), LED_CURVE_16((B) + 16), LED_CURVE_16((B) + 32), LED_CURVE_16((B) + 48)
+
+const uint16_t led_curve_table[256] =
+{
+    LED_CURVE_64(0), LED_CURVE_64(64), LED_CURVE_64(128), LED_CURVE_64(192)
+};
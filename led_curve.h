@@ -0,0 +1,60 @@
+/**@file
+ *
+ * @defgroup led_curve Perceptual LED brightness curve
+ * @{
+ * @brief    Maps an 8-bit brightness to the native PWM range along the CIE 1976 lightness curve.
+ *
+ * @details  Equal brightness steps look equally large to the eye, so the low end of the native range
+ *           gets fine steps and the high end coarse ones. The table is generated by the
+ *           preprocessor for the PWM mode in LED_CURVE_PWM_MODE, so it always matches the range the
+ *           PWM library is configured with. Mapping a value is a single table load, and
+ *           LED_CURVE_VALUE folds to a constant for constant arguments.
+ *
+ *           Motor outputs and other linear loads use PWM_LINEAR_VALUE instead, a multiply and a
+ *           shift.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef LED_CURVE_H__
+#define LED_CURVE_H__
+
+#include <stdint.h>
+#include "nrf_pwm.h"
+
+#ifndef LED_CURVE_PWM_MODE
+#define LED_CURVE_PWM_MODE              PWM_MODE_LED_1000            /**< PWM mode the table is generated for, pass it to nrf_pwm_init. */
+#endif
+
+#define LED_CURVE_MAX                   PWM_MODE_MAX_VALUE(LED_CURVE_PWM_MODE) /**< Native value for full brightness. */
+
+/**@brief   Native value for an 8-bit brightness B on the CIE lightness curve, a constant expression.
+ *
+ * @details L* = 100 * B / 255. Below L* = 8 the luminance is L* / 903.3, above it is
+ *          ((L* + 16) / 116)^3. Both are evaluated in integers with the divisions last and rounded.
+ */
+#define LED_CURVE_VALUE(B)                                                                            \
+    ((uint16_t)(((uint32_t)(B) * 100 <= 8 * 255)                                                      \
+        ? (((uint64_t)(B) * 1000 * LED_CURVE_MAX + (255ULL * 9033) / 2) / (255ULL * 9033))           \
+        : (((uint64_t)((B) * 100 + 16 * 255) * ((B) * 100 + 16 * 255) * ((B) * 100 + 16 * 255)        \
+            * LED_CURVE_MAX + (29580ULL * 29580 * 29580) / 2) / (29580ULL * 29580 * 29580))))
+
+/**@brief   Native value for an 8-bit level V on a linear scale, 255 maps to exactly LED_CURVE_MAX. */
+#define PWM_LINEAR_VALUE(V)             ((uint16_t)(((uint32_t)(V) * LED_CURVE_MAX * 257 + 32768) >> 16))
+
+extern const uint16_t led_curve_table[256];                          /**< LED_CURVE_VALUE for every brightness. */
+
+/**@brief       Function for mapping a brightness to the native PWM range.
+ *
+ * @param[in]   brightness  8-bit brightness, 0 is off and 255 full.
+ *
+ * @return      Native PWM value.
+ */
+static inline uint16_t led_curve_map(uint8_t brightness)
+{
+    return led_curve_table[brightness];
+}
+
+#endif // LED_CURVE_H__
+
+/** @} */
@@ -29,7 +29,6 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include <stdlib.h>
 #include <string.h>
 #include "nordic_common.h"
 #include "nrf.h"
@@ -45,6 +44,20 @@
 #include "app_util_platform.h"
 
 #include "nrf_pwm.h"
+#include "adc_filter.h"
+#include "sensor_pipeline.h"
+#include "sensor_config.h"
+#include "sensor_event.h"
+#include "energy_stats.h"
+#include "anim_mixer.h"
+#include "motor_profile.h"
+#include "led_curve.h"
+#include "fill_level.h"
+#include "rx_value.h"
+#include "pattern_store.h"
+#include "actuator_mailbox.h"
+#include "evt_queue.h"
+#include "pstorage.h"
 #include "nrf_gpio.h"
 #include "nrf_delay.h"
 
@@ -86,38 +99,586 @@ static ble_nus_t                        m_nus;
 // for this app
 #define LED_PIN                         8
 #define MOTOR_PIN                       9
-#define ADC_SAMPLING_INTERVAL           APP_TIMER_TICKS(20, APP_TIMER_PRESCALER)   /**< Sampling rate for the ADC (10ms) */
+#define LED_FRAME_INTERVAL              APP_TIMER_TICKS(20, APP_TIMER_PRESCALER)   /**< Time between two LED fade steps (20ms). */
+#define MOTOR_FRAME_INTERVAL            APP_TIMER_TICKS(10, APP_TIMER_PRESCALER)   /**< Time between two motor pattern steps (10ms), short enough to resolve the kick-start and brake times. */
+#define MOTOR_KICK_LEVEL                255                                         /**< Default drive during the kick-start on a rising step. */
+#define MOTOR_KICK_MS                   30                                          /**< Default kick-start time for a full-scale rising step. */
+#define MOTOR_BRAKE_MS                  30                                          /**< Default zero-drive time for a full-scale falling step. */
+#define MOTOR_EDGE_THRESHOLD            40                                          /**< Default smallest step that gets a kick-start or brake. */
+#define LED_FLASH_MS                    20                                          /**< Time the LED is held at full brightness when a value is received. */
+#define LED_FADE_MS                     1000                                        /**< Duration of a fade over the full 0-255 range, shorter fades take proportionally less time. */
+#define PWM_CHANNEL_LED                 0                                           /**< PWM channel driving LED_PIN. */
+#define PWM_CHANNEL_MOTOR               1                                           /**< PWM channel driving MOTOR_PIN. */
+#define PWM_CHANNEL_COUNT               2                                           /**< PWM channels in use, the LED and the motor. */
+#define LED_DECAY_SEGMENT_MS            60000                                       /**< Longest LED decay fade, the fill level is brought up to date and the fade replanned after each. */
+#define FILL_CAPACITY                   255                                         /**< Default fill level capacity, in units of received value / 10. A full bucket is full LED brightness. */
+#define FILL_DECAY_PER_MIN              60                                          /**< Default fill level drain per minute, in the same units. */
+#define FILL_DECAY_TO_RATE(PER_MIN)     (((uint32_t)(PER_MIN) << FILL_LEVEL_FRAC_BITS) / 60) /**< Converts a drain per minute to fill_level_config_t.decay_rate. */
+#define FILL_RATE_TO_DECAY(RATE)        (((uint32_t)(RATE) * 60 + (1 << (FILL_LEVEL_FRAC_BITS - 1))) >> FILL_LEVEL_FRAC_BITS) /**< Converts fill_level_config_t.decay_rate back to a drain per minute. */
+#define MAIN_EVT_DATA_SIZE              MAX(BLE_STACK_EVT_MSG_BUF_SIZE, sizeof(uint32_t))  /**< Largest event deferred to the main loop: a BLE event as read by the SoftDevice handler, or a system event. */
+#define ACTUATOR_CMD_IRQn               SWI3_IRQn                                   /**< Software interrupt running the actuator commands, at the priority of the app_timer handlers that advance the patterns. */
+#define ACTUATOR_CMD_IRQHandler         SWI3_IRQHandler                             /**< Handler of ACTUATOR_CMD_IRQn. */
+#define PATTERN_PLAY_CMD_FLAG           0x80                                        /**< A one-byte write with this bit set plays the stored pattern with the ID in the low bits, an optional second byte selects the anim_policy_t. */
+#define ADC_SAMPLING_INTERVAL_FAST      APP_TIMER_TICKS(5, APP_TIMER_PRESCALER)    /**< Sampling rate for the ADC while the signal is near the threshold or changing, or the actuators run other than the LED decay (5ms). */
+#define ADC_SAMPLING_INTERVAL_IDLE      APP_TIMER_TICKS(200, APP_TIMER_PRESCALER)  /**< Sampling rate for the ADC while connected and quiet (200ms). */
+#define ADC_SAMPLING_INTERVAL_DISCONN   APP_TIMER_TICKS(500, APP_TIMER_PRESCALER)  /**< Sampling rate for the ADC while not connected and quiet (500ms). */
+#define ADC_PPI_CHANNEL                 6                                           /**< PPI channel connecting HFCLKSTARTED to the ADC START task (the PWM library takes 0-3 for its outputs, 4 for its waveform sequencer and 5 for its RTC backend). */
+#define ADC_TRIGGER_BUSY_WAIT           0                                           /**< Set to 1 to spin on the HFCLK start in the timer handler instead of using PPI (for profiling comparisons only). */
+#define ADC_BATTERY_RATE_DIVISOR        200                                         /**< The battery voltage is sampled every this many sampling ticks (1s at 5ms). */
+#define ADC_AUX_SENSOR_ENABLED          0                                           /**< Set to 1 to also scan the auxiliary sensor on AIN3. */
+#define ADC_CHANNEL_SENSOR              0                                           /**< Scan list index of the droplet sensor. */
+#define ADC_CHANNEL_BATTERY             1                                           /**< Scan list index of the VDD/3 battery measurement. */
+#define ADC_CHANNEL_AUX                 2                                           /**< Scan list index of the auxiliary sensor, if enabled. */
+#define ADC_CHANNEL_COUNT               (2 + ADC_AUX_SENSOR_ENABLED)                /**< Number of entries in the scan list. */
+#define ADC_CONFIG_AIN(PSEL)            ((ADC_CONFIG_EXTREFSEL_None << ADC_CONFIG_EXTREFSEL_Pos)   | \
+                                         ((PSEL) << ADC_CONFIG_PSEL_Pos)                          | \
+                                         (ADC_CONFIG_REFSEL_VBG << ADC_CONFIG_REFSEL_Pos)          | \
+                                         (ADC_CONFIG_INPSEL_AnalogInputOneThirdPrescaling << ADC_CONFIG_INPSEL_Pos) | \
+                                         (ADC_CONFIG_RES_10bit << ADC_CONFIG_RES_Pos))               /**< ADC CONFIG value for an analog input, 1/3 prescaling against the 1.2V band gap. */
+#define ADC_CONFIG_VDD                  ((ADC_CONFIG_EXTREFSEL_None << ADC_CONFIG_EXTREFSEL_Pos)   | \
+                                         (ADC_CONFIG_PSEL_Disabled << ADC_CONFIG_PSEL_Pos)        | \
+                                         (ADC_CONFIG_REFSEL_VBG << ADC_CONFIG_REFSEL_Pos)          | \
+                                         (ADC_CONFIG_INPSEL_SupplyOneThirdPrescaling << ADC_CONFIG_INPSEL_Pos) | \
+                                         (ADC_CONFIG_RES_10bit << ADC_CONFIG_RES_Pos))               /**< ADC CONFIG value for VDD/3 against the 1.2V band gap. */
+#define ADC_CONVERSION_TIME_US          68                                          /**< Duration of one 10-bit conversion, used for the ADC on-time accounting. */
+#define ADC_RESULT_TO_MV(RESULT)        ((uint32_t)(RESULT) * 3600 / 1024)          /**< Converts a 10-bit result with 1/3 prescaling against the band gap to mV. */
+#define MS_TO_TICKS(MS)                 ((uint32_t)(MS) * 32768 / (1000 * (APP_TIMER_PRESCALER + 1)))  /**< Run-time conversion from ms to RTC1 ticks, valid up to 65535 ms. */
+#define TICKS_TO_MS(TICKS)              ((uint32_t)(TICKS) * (1000 * (APP_TIMER_PRESCALER + 1)) / 32768) /**< Run-time conversion from RTC1 ticks to ms, valid up to 65535 ms. */
+
+#if (PWM_DEFAULT_PPI_MASK(PWM_CHANNEL_COUNT) & (1UL << ADC_PPI_CHANNEL))
+#error "ADC_PPI_CHANNEL is one of the PPI channels the PWM library takes with PWM_DEFAULT_CONFIG"
+#endif
+
 static app_timer_id_t                   m_adc_sampling_timer_id;
+static uint32_t                         m_adc_profile_samples;                      /**< Number of ADC conversions since the last profile reset. */
+static uint32_t                         m_adc_profile_cpu_ticks;                    /**< RTC1 ticks spent in the sampling timer handler and the ADC ISR since the last profile reset. */
+static volatile uint8_t                 m_adc_burst_remaining;                      /**< Conversions left in the burst of the channel being converted. */
+static volatile uint8_t                 m_adc_scan_pending;                         /**< Bit mask of the channels still to be converted in this sampling tick. */
+static volatile uint8_t                 m_adc_scan_channel;                         /**< Channel being converted. */
+
+/**@brief   One entry of the ADC scan list. */
+typedef struct
+{
+    uint32_t                 config;                  /**< NRF_ADC->CONFIG value: input, reference, prescaling and resolution. */
+    uint8_t                  rate_divisor;            /**< The channel is converted every rate_divisor sampling ticks. */
+    uint8_t                  oversample_log2;         /**< Conversions per sample as a power of two, averaged by the decimator. */
+    uint8_t                  countdown;               /**< Sampling ticks left until the channel is due. */
+    adc_ring_t               ring;                    /**< Raw conversions from the ADC ISR, consumed by the main loop. */
+    adc_decimator_t          decimator;               /**< Oversample-and-decimate stage. */
+    volatile uint32_t        ticks;                   /**< RTC1 timestamp of the last completed burst. */
+    uint16_t                 value;                   /**< Latest decimated value. */
+} adc_channel_t;
+
+static adc_channel_t                    m_adc_channels[ADC_CHANNEL_COUNT] =
+{
+    [ADC_CHANNEL_SENSOR]  = {.config = ADC_CONFIG_AIN(ADC_CONFIG_PSEL_AnalogInput2), .rate_divisor = 1,                        .oversample_log2 = ADC_OVERSAMPLE_LOG2},
+    [ADC_CHANNEL_BATTERY] = {.config = ADC_CONFIG_VDD,                               .rate_divisor = ADC_BATTERY_RATE_DIVISOR, .oversample_log2 = 0},
+#if (ADC_AUX_SENSOR_ENABLED == 1)
+    [ADC_CHANNEL_AUX]     = {.config = ADC_CONFIG_AIN(ADC_CONFIG_PSEL_AnalogInput3), .rate_divisor = 1,                        .oversample_log2 = ADC_OVERSAMPLE_LOG2},
+#endif
+};                                                                                  /**< Channels scanned by the ADC, all converted under a single HFCLK request per sampling tick. */
+/**@brief   An actuator playing keyframe patterns, advanced by its own frame timer. */
+typedef struct
+{
+    app_timer_id_t           timer_id;                /**< Frame timer, only running while a pattern is playing. */
+    uint32_t                 frame_interval;          /**< Frame timer interval in RTC1 ticks. */
+    uint32_t              (* interval_get)(void);    /**< Returns the frame interval for the current segment, NULL to always use frame_interval. */
+    uint32_t                 timer_interval;          /**< Interval the frame timer was started with, 0 while it is stopped. */
+    uint8_t                  pwm_channel;             /**< PWM channel the pattern is output on. */
+    anim_mixer_t             mixer;                   /**< Effects playing or waiting, mixed into the output. */
+    uint8_t                  default_policy;          /**< @ref anim_policy_t for stored patterns played without one. */
+    uint32_t                 last_ticks;              /**< RTC1 timestamp of the previous frame. */
+    bool                     is_stored_pattern;       /**< A stored pattern in flash may be playing or waiting. */
+    bool                     is_perceptual;           /**< Levels are brightnesses mapped along the LED curve, not linear duty cycles. */
+    void                  (* idle_handler)(void);    /**< Called when the effects have finished, may submit new ones. */
+    bool                     has_drive_profile;       /**< The output is shaped by the motor_profile_config_t passed with each effect. */
+    motor_profile_t          drive;                   /**< Kick-start and brake state, if has_drive_profile is set. */
+} actuator_t;
+
+static void led_decay_continue(void);
+static uint32_t led_frame_interval_get(void);
+
+static actuator_t                       m_led   = {.frame_interval = LED_FRAME_INTERVAL,   .interval_get = led_frame_interval_get, .pwm_channel = PWM_CHANNEL_LED,   .default_policy = ANIM_POLICY_REPLACE, .is_perceptual = true, .idle_handler = led_decay_continue}; /**< LED fading to the stored level, a new level takes over at once. */
+static actuator_t                       m_motor = {.frame_interval = MOTOR_FRAME_INTERVAL, .pwm_channel = PWM_CHANNEL_MOTOR, .default_policy = ANIM_POLICY_APPEND, .has_drive_profile = true};  /**< Vibration motor, pulses are queued so that each write is felt. */
+static anim_keyframe_t                  m_led_keyframes[3];                         /**< LED pattern, rebuilt for every new level: optional flash, a fade to the fill level and its decay. Only ever submitted with ANIM_POLICY_REPLACE. */
+static fill_level_t                     m_fill;                                     /**< Received values accumulated in a leaky bucket, shown on the LED. */
+static evt_queue_t                      m_evt_queue;                                /**< SoftDevice events deferred to the main loop. */
+static uint32_t                         m_evt_queue_buffer[EVT_QUEUE_BUF_WORDS(MAIN_EVT_DATA_SIZE)]; /**< Storage of m_evt_queue. */
+static actuator_mailbox_t               m_actuator_mailbox;                         /**< Commands from the BLE event handler, the actuators and m_fill are only modified in the actuator context. */
+static const motor_profile_config_t     m_motor_profile_default = {MOTOR_KICK_LEVEL, MOTOR_KICK_MS, MOTOR_BRAKE_MS, MOTOR_EDGE_THRESHOLD}; /**< Drive profile of the built-in motor pattern and of stored patterns uploaded without one. */
+static const anim_keyframe_t            m_motor_keyframes[] =
+{
+    {20, 0,   ANIM_INTERP_STEP},
+    {20, 255, ANIM_INTERP_STEP},
+    {60, 0,   ANIM_INTERP_LINEAR},
+    {20, 175, ANIM_INTERP_STEP},
+    {60, 0,   ANIM_INTERP_LINEAR},
+    {20, 125, ANIM_INTERP_STEP},
+    {40, 0,   ANIM_INTERP_LINEAR},
+    {20, 65,  ANIM_INTERP_STEP},
+    {40, 0,   ANIM_INTERP_LINEAR},
+};                                                                                  /**< Motor pattern: three decaying pulses, 300ms. */
+static sensor_pipeline_t                m_sensor;                                   /**< Sampling rate scheduling and press detection on the filtered sensor signal. */
+static uint16_t                         m_sensor_event_sequence;                    /**< Sequence number of the next sensor event record. */
+static energy_stats_t                   m_energy;                                   /**< On-time accounting of HFCLK, CPU, PWM and ADC. */
+static volatile bool                    m_cpu_is_sleeping;                          /**< true from just before sd_app_evt_wait until the first application handler runs. */
+static volatile uint32_t                m_cpu_wake_ticks;                           /**< RTC1 timestamp at which the CPU last left sd_app_evt_wait. */
+static uint32_t                         m_adc_energy_residual;                      /**< ADC conversion time not yet accounted as whole RTC1 ticks, in us * 32768. */
+static uint8_t                          m_pwm_active_mask;                          /**< Bit mask of the PWM channels with a non-zero duty cycle. */
+static bool                             m_pwm_is_enabled;                           /**< The PWM timer is running. */
+static uint8_t                          m_pwm_update_depth;                         /**< Nesting depth of the open PWM update transactions. */
+static adc_rate_t                       m_adc_rate = ADC_RATE_FAST;                 /**< Rate the sampling timer is currently running at. */
+static const uint32_t                   m_adc_rate_interval[] = {ADC_SAMPLING_INTERVAL_FAST,
+                                                                 ADC_SAMPLING_INTERVAL_IDLE,
+                                                                 ADC_SAMPLING_INTERVAL_DISCONN}; /**< Sampling timer interval for each adc_rate_t. */
 uint32_t    val_rcvd_ble;
-uint8_t     val_adc_result;
-float       val_total_stored;
-uint8_t     val_target_illuminate_pos;
-uint8_t     counter_illuminate;
-uint8_t     counter_motor;
 bool        is_val_rcvd_ble;
-bool        is_sensor_reacting;
-bool        is_led_illuminating;
-bool        is_motor_running;
 
-const uint8_t led_table[]   = {255, 254, 252, 250, 247, 244, 240, 236, 232, 227,  \
-                               221, 216, 213, 210, 203, 197, 190, 182, 175, 168,  \
-                               160, 152, 144, 136, 128, 120, 112, 104, 96,  91,   \
-                               88,  81,  74,  66,  59,  53,  46,  40,  35,  29,   \
-                               24,  20,  16,  12,  9,   6,   4,   2,   1,   0};
-const uint8_t motor_table[] = {0,   255, 125, 75,  0,   175, 125, 75,  0,   125, 65, 0, 65, 35, 0};
+
+/**@brief   Function for adding the RTC1 ticks elapsed since start_ticks to the ADC CPU time counter.
+ *
+ * @details The RTC1 resolution (30.5 us) is coarser than a single ISR run, but averaged over many
+ *          samples m_adc_profile_cpu_ticks / m_adc_profile_samples gives the CPU time per sample.
+ */
+static void adc_profile_add(uint32_t start_ticks)
+{
+    uint32_t    now_ticks;
+    uint32_t    ticks;
+
+    app_timer_cnt_get(&now_ticks);
+    ticks = (now_ticks - start_ticks) & 0x00FFFFFF;
+    m_adc_profile_cpu_ticks += ticks;
+}
+
+
+/**@brief   Function for ending the sleep of the main loop from an application handler.
+ *
+ * @details Interrupts run inside sd_app_evt_wait, before it returns, so each handler that can wake
+ *          the CPU calls this first. The time from here on is then counted as CPU time, not sleep.
+ *
+ * @param[in]   now_ticks   RTC1 timestamp of the start of the handler.
+ */
+static void energy_cpu_wake_mark(uint32_t now_ticks)
+{
+    if (m_cpu_is_sleeping)
+    {
+        m_cpu_wake_ticks  = now_ticks;
+        m_cpu_is_sleeping = false;
+    }
+}
+
+
+/**@brief   Function for stopping the PWM timer if all outputs are off and no update transaction
+ *          is open.
+ *
+ * @details Stopping the timer drives the outputs low at once, so inside a transaction it would
+ *          show the staged zeros before the values they are committed with.
+ */
+static void pwm_idle_check(uint32_t now_ticks)
+{
+    if (m_pwm_is_enabled && !m_pwm_active_mask && (m_pwm_update_depth == 0))
+    {
+        nrf_pwm_set_enabled(false);
+        m_pwm_is_enabled = false;
+        energy_stats_stop(&m_energy, ENERGY_PWM, now_ticks);
+    }
+}
+
+/**@brief   Function for setting a PWM output, stopping the PWM timer while all outputs are off.
+ *
+ * @details The PWM timer keeps the 16 MHz clock running, so it is only started while at least one
+ *          channel has a non-zero duty cycle. Its run time is accounted as ENERGY_PWM.
+ */
+static void pwm_value_set(uint32_t channel, uint32_t value)
+{
+    uint32_t    now_ticks;
+
+    if (value > 0)
+    {
+        m_pwm_active_mask |= (1 << channel);
+    }
+    else
+    {
+        m_pwm_active_mask &= ~(1 << channel);
+    }
+
+    app_timer_cnt_get(&now_ticks);
+    if (!m_pwm_is_enabled && m_pwm_active_mask)
+    {
+        nrf_pwm_set_enabled(true);
+        m_pwm_is_enabled = true;
+        energy_stats_start(&m_energy, ENERGY_PWM, now_ticks);
+    }
+    nrf_pwm_set_value(channel, value);
+    pwm_idle_check(now_ticks);
+}
+
+/**@brief   Function for opening a PWM update transaction, see nrf_pwm_update_begin.
+ */
+static void pwm_update_begin(void)
+{
+    m_pwm_update_depth++;
+    nrf_pwm_update_begin();
+}
+
+/**@brief   Function for committing a PWM update transaction, then stopping the PWM timer if the
+ *          committed values switched all outputs off.
+ */
+static void pwm_update_commit(void)
+{
+    uint32_t now_ticks;
+
+    nrf_pwm_update_commit();
+    m_pwm_update_depth--;
+    app_timer_cnt_get(&now_ticks);
+    pwm_idle_check(now_ticks);
+}
+
+
+/**@brief   Function for selecting the next pending channel of the scan and configuring the ADC for it.
+ *
+ * @return  false if no channel is pending.
+ */
+static bool adc_scan_next(void)
+{
+    uint8_t ch;
+
+    if (m_adc_scan_pending == 0)
+    {
+        return false;
+    }
+    for (ch = 0; (m_adc_scan_pending & (1 << ch)) == 0; ch++)
+    {
+    }
+    m_adc_scan_pending &= ~(1 << ch);
+    m_adc_scan_channel = ch;
+    m_adc_burst_remaining = (1 << m_adc_channels[ch].oversample_log2);
+    NRF_ADC->CONFIG = m_adc_channels[ch].config;
+    return true;
+}
 
 
 /**@brief   Function for ADC timer handler to start ADC sampling
+ *
+ * @details The handler only requests the HFCLK. The ADC START task is triggered by the
+ *          HFCLKSTARTED event through PPI, so no CPU time is spent waiting for the crystal.
+ *          If the crystal is already running (e.g. during a radio event) no HFCLKSTARTED event
+ *          will follow, so the conversion is started directly, unless PPI has started it since
+ *          the channel was enabled.
 */
 static void adc_sampling_timeout_handler(void * p_context)
 {
     uint32_t    p_is_running = 0;
+    uint32_t    start_ticks;
 
+    app_timer_cnt_get(&start_ticks);
+    energy_cpu_wake_mark(start_ticks);
+
+    m_adc_scan_pending = 0;
+    for (uint8_t ch = 0; ch < ADC_CHANNEL_COUNT; ch++)
+    {
+        if (--m_adc_channels[ch].countdown == 0)
+        {
+            m_adc_channels[ch].countdown = m_adc_channels[ch].rate_divisor;
+            m_adc_scan_pending |= (1 << ch);
+        }
+    }
+    if (!adc_scan_next())
+    {
+        adc_profile_add(start_ticks);
+        return;
+    }
+#if (ADC_TRIGGER_BUSY_WAIT == 1)
     sd_clock_hfclk_request();
     while(!p_is_running) {
         sd_clock_hfclk_is_running((&p_is_running));
     }
     NRF_ADC->TASKS_START = 1;
+    energy_stats_start(&m_energy, ENERGY_HFCLK, start_ticks);
+#else
+    /* The PPI channel is enabled before the clock is requested, so an HFCLK start by another
+       requester in between still triggers the conversion. */
+    sd_ppi_channel_enable_set(1 << ADC_PPI_CHANNEL);
+    sd_clock_hfclk_request();
+    energy_stats_start(&m_energy, ENERGY_HFCLK, start_ticks);
+    sd_clock_hfclk_is_running(&p_is_running);
+    if (p_is_running)
+    {
+        /* Started before the channel was enabled, so no HFCLKSTARTED will follow. A conversion
+           started through PPI meanwhile is still busy or has ended. */
+        sd_ppi_channel_enable_clr(1 << ADC_PPI_CHANNEL);
+        if (!NRF_ADC->BUSY && !NRF_ADC->EVENTS_END)
+        {
+            NRF_ADC->TASKS_START = 1;
+        }
+    }
+#endif
+    adc_profile_add(start_ticks);
+}
+
+/**@brief   Function for advancing the effects of an actuator to now and getting its drive level.
+ *
+ * @details The mixed effect level goes through the drive profile of the effect on the main track,
+ *          if the actuator has one.
+ */
+static uint8_t actuator_advance(actuator_t * p_actuator, uint32_t now_ticks)
+{
+    uint32_t    elapsed_ticks = (now_ticks - p_actuator->last_ticks) & 0x00FFFFFF;
+    uint8_t     value;
+
+    // A pattern store write makes the stored keyframes and profiles unreadable, stop at the
+    // current output without reading them.
+    if (p_actuator->is_stored_pattern && pattern_store_is_busy())
+    {
+        anim_mixer_stop(&p_actuator->mixer);
+        p_actuator->is_stored_pattern = false;
+    }
+
+    p_actuator->last_ticks = now_ticks;
+    value = anim_mixer_advance(&p_actuator->mixer, elapsed_ticks);
+    if (p_actuator->has_drive_profile)
+    {
+        value = motor_profile_apply(&p_actuator->drive, p_actuator->mixer.p_main_context, value,
+                                    p_actuator->mixer.is_step, elapsed_ticks);
+    }
+    return value;
+}
+
+/**@brief   Function for outputting an 8-bit level on an actuator in the native PWM range.
+ */
+static void actuator_output_set(const actuator_t * p_actuator, uint8_t value)
+{
+    pwm_value_set(p_actuator->pwm_channel,
+                  p_actuator->is_perceptual ? led_curve_map(value) : PWM_LINEAR_VALUE(value));
+}
+
+/**@brief   Function for checking whether the output of an actuator may still change.
+ */
+static bool actuator_is_running(const actuator_t * p_actuator)
+{
+    return anim_mixer_is_running(&p_actuator->mixer) ||
+           (p_actuator->has_drive_profile && motor_profile_is_active(&p_actuator->drive));
+}
+
+/**@brief   Function for running the frame timer of a playing actuator at the interval its current
+ *          segment needs.
+ *
+ * @details The timer is only restarted when the interval changes, so frames keep their timing
+ *          otherwise.
+ */
+static void actuator_timer_update(actuator_t * p_actuator)
+{
+    uint32_t    err_code;
+    uint32_t    interval;
+
+    interval = (p_actuator->interval_get != NULL) ? p_actuator->interval_get() : p_actuator->frame_interval;
+    if (interval == p_actuator->timer_interval)
+    {
+        return;
+    }
+    err_code = app_timer_stop(p_actuator->timer_id);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_timer_start(p_actuator->timer_id, interval, p_actuator);
+    APP_ERROR_CHECK(err_code);
+    p_actuator->timer_interval = interval;
+}
+
+/**@brief   Function for the frame timer handler of an actuator, advancing its pattern to now.
+ *
+ * @details The pattern is advanced by the measured time since the previous frame, so late or
+ *          skipped frames do not slow it down.
+ */
+static void actuator_frame_timeout_handler(void * p_context)
+{
+    actuator_t *    p_actuator = (actuator_t *)p_context;
+    uint32_t        now_ticks;
+    uint32_t        err_code;
+
+    app_timer_cnt_get(&now_ticks);
+    energy_cpu_wake_mark(now_ticks);
+    actuator_output_set(p_actuator, actuator_advance(p_actuator, now_ticks));
+
+    if (!actuator_is_running(p_actuator))
+    {
+        p_actuator->is_stored_pattern = false;
+        err_code = app_timer_stop(p_actuator->timer_id);
+        APP_ERROR_CHECK(err_code);
+        p_actuator->timer_interval = 0;
+
+        if (p_actuator->idle_handler != NULL)
+        {
+            p_actuator->idle_handler();
+        }
+    }
+    else
+    {
+        actuator_timer_update(p_actuator);
+    }
+}
+
+/**@brief   Function for submitting an effect to an actuator.
+ *
+ * @details Effects that start playing right away are output immediately. The frame timer is only
+ *          (re)started when the actuator was idle or needs another interval, so a burst of effects
+ *          does not disturb the frame timing of the ones playing.
+ *
+ * @param[in]   p_actuator  Actuator.
+ * @param[in]   policy      @ref anim_policy_t.
+ * @param[in]   p_keyframes Keyframes, NULL with count 0 stops the actuator at its current output.
+ * @param[in]   count       Number of keyframes.
+ * @param[in]   p_profile   Drive profile of the effect, NULL for none. Ignored by actuators without
+ *                          a drive profile.
+ * @param[in]   is_stored   true if the keyframes and profile are in the pattern store.
+ */
+static void actuator_effect_submit(actuator_t *                   p_actuator,
+                                   uint8_t                        policy,
+                                   const anim_keyframe_t *        p_keyframes,
+                                   uint8_t                        count,
+                                   const motor_profile_config_t * p_profile,
+                                   bool                           is_stored)
+{
+    uint32_t    now_ticks;
+    bool        was_running = actuator_is_running(p_actuator);
+
+    // Bring the tracks up to now so that the new effect starts from the current output.
+    app_timer_cnt_get(&now_ticks);
+    (void)actuator_advance(p_actuator, now_ticks);
+
+    if ((policy >= ANIM_POLICY_COUNT) || (policy == ANIM_POLICY_REPLACE))
+    {
+        p_actuator->is_stored_pattern = is_stored;
+    }
+    else
+    {
+        p_actuator->is_stored_pattern |= is_stored;
+    }
+    anim_mixer_submit(&p_actuator->mixer, policy, p_keyframes, count, p_profile);
+    actuator_output_set(p_actuator, actuator_advance(p_actuator, now_ticks));
+
+    if (actuator_is_running(p_actuator))
+    {
+        // A stop leaves the timer running until its next frame, make sure it is restarted cleanly.
+        if (!was_running)
+        {
+            p_actuator->timer_interval = 0;
+        }
+        actuator_timer_update(p_actuator);
+    }
+}
+
+/**@brief   Function for showing the fill level on the LED.
+ *
+ * @details The fill level is only brought up to date here, the LED fades to it and then follows its
+ *          decay with a linear fade planned ahead, so the decay needs no timer of its own.
+ *
+ * @param[in]   is_flash    true to start the fade from full brightness, false to start from the
+ *                          current LED output.
+ */
+static void led_level_show(bool is_flash)
+{
+    uint32_t    now_ticks;
+    uint32_t    fade_ms;
+    uint32_t    decay_ms;
+    uint8_t     from;
+    uint8_t     level;
+    uint8_t     distance;
+
+    app_timer_cnt_get(&now_ticks);
+    (void)fill_level_update(&m_fill, now_ticks);
+
+    // Aim the fade at the level the bucket will have drained to by the time it ends.
+    from     = is_flash ? 255 : m_led.mixer.value;
+    level    = fill_level_scale(&m_fill, m_fill.level);
+    distance = (from > level) ? (from - level) : (level - from);
+    fade_ms  = (is_flash ? LED_FLASH_MS : 0) + (uint32_t)LED_FADE_MS * distance / 255;
+    level    = fill_level_scale(&m_fill, fill_level_predict(&m_fill, fade_ms));
+
+    decay_ms = 0;
+    if (m_fill.config.decay_rate > 0)
+    {
+        decay_ms = fill_level_ms_to_empty(&m_fill);
+        decay_ms = (decay_ms > fade_ms) ? (decay_ms - fade_ms) : 0;
+        decay_ms = (decay_ms > LED_DECAY_SEGMENT_MS) ? LED_DECAY_SEGMENT_MS : decay_ms;
+    }
+
+    m_led_keyframes[0].duration_ms = is_flash ? LED_FLASH_MS : 0;
+    m_led_keyframes[0].value       = from;
+    m_led_keyframes[0].interp      = ANIM_INTERP_STEP;
+    m_led_keyframes[1].duration_ms = fade_ms - m_led_keyframes[0].duration_ms;
+    m_led_keyframes[1].value       = level;
+    m_led_keyframes[1].interp      = ANIM_INTERP_EASE;
+    m_led_keyframes[2].duration_ms = decay_ms;
+    m_led_keyframes[2].value       = fill_level_scale(&m_fill, fill_level_predict(&m_fill, fade_ms + decay_ms));
+    m_led_keyframes[2].interp      = ANIM_INTERP_LINEAR;
+
+    actuator_effect_submit(&m_led, ANIM_POLICY_REPLACE,
+                           m_led_keyframes, sizeof(m_led_keyframes) / sizeof(m_led_keyframes[0]), NULL, false);
+}
+
+/**@brief   Function for checking whether the LED only follows the planned decay of the fill level.
+ *
+ * @details The decay drains the bucket by about one LED step per second, for minutes after a single
+ *          write. It is not activity for the ADC scheduler and needs no 20 ms frames.
+ */
+static bool led_is_decaying(void)
+{
+    const anim_mixer_t *    p_mixer = &m_led.mixer;
+
+    return anim_player_is_running(&p_mixer->main) &&
+           (p_mixer->main.p_keyframes == m_led_keyframes) &&
+           (p_mixer->main.index == sizeof(m_led_keyframes) / sizeof(m_led_keyframes[0]) - 1) &&
+           !anim_player_is_running(&p_mixer->overlay) &&
+           (p_mixer->queue_count == 0);
+}
+
+/**@brief   Function for getting the LED frame interval, one frame per output step during the decay.
+ */
+static uint32_t led_frame_interval_get(void)
+{
+    const anim_player_t *   p_main = &m_led.mixer.main;
+    uint32_t                steps;
+    uint32_t                interval;
+
+    if (!led_is_decaying())
+    {
+        return LED_FRAME_INTERVAL;
+    }
+    steps    = (p_main->from > m_led_keyframes[2].value) ? (p_main->from - m_led_keyframes[2].value)
+                                                         : (m_led_keyframes[2].value - p_main->from);
+    interval = p_main->duration_ticks / ((steps > 0) ? steps : 1);
+    return (interval > LED_FRAME_INTERVAL) ? interval : LED_FRAME_INTERVAL;
+}
+
+/**@brief   Function for replanning the LED decay when its fade has ended and the bucket has not
+ *          drained yet.
+ */
+static void led_decay_continue(void)
+{
+    uint32_t now_ticks;
+
+    app_timer_cnt_get(&now_ticks);
+    if ((m_fill.config.decay_rate > 0) && (fill_level_update(&m_fill, now_ticks) > 0))
+    {
+        led_level_show(false);
+    }
+}
+
+/**@brief   Function for showing the fill level on the LED and queueing a motor pulse.
+ *
+ * @details The first LED and motor outputs are committed as one PWM update, so the flash and the
+ *          kick-start begin in the same PWM period.
+ *
+ * @param[in]   is_flash    true to start the LED fade from full brightness, false to start from
+ *                          the current LED output.
+ */
+static void animation_start(bool is_flash)
+{
+    pwm_update_begin();
+    led_level_show(is_flash);
+    actuator_effect_submit(&m_motor, m_motor.default_policy,
+                           m_motor_keyframes, sizeof(m_motor_keyframes) / sizeof(m_motor_keyframes[0]),
+                           &m_motor_profile_default, false);
+    pwm_update_commit();
 }
 
 /**@brief Function for starting application timers.
@@ -127,79 +688,186 @@ static void application_timers_start(void)
     uint32_t err_code;
 
     //ADC timer start
-    err_code = app_timer_start(m_adc_sampling_timer_id, ADC_SAMPLING_INTERVAL, NULL);
+    err_code = app_timer_start(m_adc_sampling_timer_id, m_adc_rate_interval[m_adc_rate], NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+/**@brief   Function for restarting the ADC sampling timer when the scheduled rate changes.
+ *
+ * @details Called from the main loop only, which is woken up after every interrupt, so connection
+ *          and animation state changes are picked up without touching the timer from other contexts.
+ */
+static void adc_sampling_rate_update(void)
+{
+    uint32_t    err_code;
+    adc_rate_t  rate;
+
+    rate = adc_scheduler_rate_get(&m_sensor.scheduler,
+                                  (actuator_is_running(&m_led) && !led_is_decaying()) ||
+                                  actuator_is_running(&m_motor),
+                                  m_conn_handle != BLE_CONN_HANDLE_INVALID);
+    if (rate == m_adc_rate)
+    {
+        return;
+    }
+    m_adc_rate = rate;
+
+    err_code = app_timer_stop(m_adc_sampling_timer_id);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_timer_start(m_adc_sampling_timer_id, m_adc_rate_interval[rate], NULL);
     APP_ERROR_CHECK(err_code);
 }
 
 //ADC initialization
 static void adc_init(void)
 {   
+    uint32_t err_code;
+
+    /* Start a conversion as soon as the HFCLK is running. The channel is only enabled while a
+       sample is pending, so HFCLK starts requested by the SoftDevice do not trigger the ADC. */
+    err_code = sd_ppi_channel_assign(ADC_PPI_CHANNEL, &NRF_CLOCK->EVENTS_HFCLKSTARTED, &NRF_ADC->TASKS_START);
+    APP_ERROR_CHECK(err_code);
+
     /* Enable interrupt on ADC sample ready event*/     
     NRF_ADC->INTENSET = ADC_INTENSET_END_Msk;   
     sd_nvic_SetPriority(ADC_IRQn, NRF_APP_PRIORITY_LOW);  
     sd_nvic_EnableIRQ(ADC_IRQn);
     
-    NRF_ADC->CONFIG = (ADC_CONFIG_EXTREFSEL_None << ADC_CONFIG_EXTREFSEL_Pos)   |
-                      (ADC_CONFIG_PSEL_AnalogInput2 << ADC_CONFIG_PSEL_Pos)     |
-                      (ADC_CONFIG_REFSEL_VBG << ADC_CONFIG_REFSEL_Pos)          |
-                      (ADC_CONFIG_INPSEL_AnalogInputOneThirdPrescaling << ADC_CONFIG_INPSEL_Pos)    |
-                      (ADC_CONFIG_RES_8bit << ADC_CONFIG_RES_Pos);
+    NRF_ADC->CONFIG = m_adc_channels[ADC_CHANNEL_SENSOR].config;
 
     NRF_ADC->ENABLE = ADC_ENABLE_ENABLE_Enabled;
+
+    for (uint8_t ch = 0; ch < ADC_CHANNEL_COUNT; ch++)
+    {
+        // Convert every channel on the first sampling tick.
+        m_adc_channels[ch].countdown = 1;
+        adc_ring_init(&m_adc_channels[ch].ring);
+        adc_decimator_init(&m_adc_channels[ch].decimator, m_adc_channels[ch].oversample_log2);
+    }
+
+    sensor_pipeline_config_t sensor_config;
+    sensor_config.scheduler.near_band          = ADC_SCHED_NEAR_BAND;
+    sensor_config.scheduler.change_delta       = ADC_SCHED_CHANGE_DELTA;
+    sensor_config.scheduler.quiet_samples      = ADC_SCHED_QUIET_SAMPLES;
+    sensor_config.detector.press_threshold     = 0;
+    sensor_config.detector.release_threshold   = 0;
+    sensor_config.detector.dwell_ticks         = MS_TO_TICKS(SENSOR_DWELL_MS);
+    sensor_config.detector.refractory_ticks    = MS_TO_TICKS(SENSOR_REFRACTORY_MS);
+    sensor_config.press_depth                  = SENSOR_PRESS_DEPTH;
+    sensor_config.release_depth                = SENSOR_RELEASE_DEPTH;
+    sensor_config.baseline_shift               = SENSOR_BASELINE_SHIFT;
+    sensor_config.max_press_ticks              = MS_TO_TICKS(SENSOR_MAX_PRESS_MS);
+    sensor_pipeline_init(&m_sensor, &sensor_config);
+}
+
+/**@brief   Function for handling one filtered sample from the droplet sensor.
+ */
+static void sensor_sample_handle(uint16_t value, uint32_t sample_ticks)
+{
+    uint32_t        err_code;
+    sensor_event_t  event;
+    uint8_t         record[SENSOR_EVENT_LEN];
+    uint16_t        length;
+
+    if (!sensor_pipeline_sample(&m_sensor, value, sample_ticks))
+    {
+        return;
+    }
+
+    event.type         = SENSOR_EVENT_TYPE_PRESS;
+    event.sequence     = m_sensor_event_sequence++;
+    event.sample_ticks = sample_ticks;
+    app_timer_cnt_get(&event.queued_ticks);
+    length = sensor_event_encode(&event, record);
+
+    // Events that cannot be queued are dropped; the peer sees them as sequence gaps.
+    err_code = ble_nus_send_string(&m_nus, record, length);
+    if (err_code == NRF_SUCCESS)
+    {
+        press_detector_latency_record(&m_sensor.detector, sample_ticks, event.queued_ticks);
+    }
+    else if ((err_code != NRF_ERROR_INVALID_STATE) && (err_code != BLE_ERROR_NO_TX_BUFFERS))
+    {   
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+/**@brief   Function for draining the raw sample buffers through their decimators.
+ *
+ * @details Called from the main loop, so the filtering and the notification are kept out of the
+ *          ADC interrupt. The latest value of every channel is kept in m_adc_channels[].value.
+ */
+static void adc_samples_process(void)
+{
+    uint16_t    raw;
+    uint16_t    filtered;
+
+    for (uint8_t ch = 0; ch < ADC_CHANNEL_COUNT; ch++)
+    {
+        adc_channel_t * p_channel = &m_adc_channels[ch];
+
+        while (adc_ring_get(&p_channel->ring, &raw))
+        {
+            if (!adc_decimator_put(&p_channel->decimator, raw, &filtered))
+            {
+                continue;
+            }
+            p_channel->value = filtered;
+            if (ch == ADC_CHANNEL_SENSOR)
+            {
+                sensor_sample_handle(filtered, p_channel->ticks);
+            }
+        }
+    }
 }
 
 /* Interrupt handler for ADC data ready event */
 void ADC_IRQHandler(void)
 {
+    uint32_t        start_ticks;
+    adc_channel_t * p_channel;
+
+    app_timer_cnt_get(&start_ticks);
+    energy_cpu_wake_mark(start_ticks);
+
     /* Clear dataready event */
     NRF_ADC->EVENTS_END = 0;  
 
-    /* send ADC result via BLE */
-    val_adc_result = NRF_ADC->RESULT;
-    if (val_adc_result < 75) {
-        if (!is_sensor_reacting) {
-            uint32_t    err_code;
-            is_sensor_reacting = true;
+    /* hand the raw result to the main loop */
+    p_channel = &m_adc_channels[m_adc_scan_channel];
+    adc_ring_put(&p_channel->ring, (uint16_t)NRF_ADC->RESULT);
+    m_adc_profile_samples++;
 
-            err_code = ble_nus_send_string(&m_nus, (uint8_t*)"PUSH", 7);
-            if (err_code != NRF_ERROR_INVALID_STATE)
-            {   
-                APP_ERROR_CHECK(err_code);
-            }
-        }
-    } else {
-        if (is_sensor_reacting) is_sensor_reacting = false;
+    m_adc_energy_residual += ADC_CONVERSION_TIME_US * 32768;
+    while (m_adc_energy_residual >= 1000000)
+    {
+        m_adc_energy_residual -= 1000000;
+        energy_stats_add(&m_energy, ENERGY_ADC, 1);
     }
 
-    if (is_led_illuminating)
+    /* keep converting until the oversampling burst is complete, then move to the next channel */
+    if (--m_adc_burst_remaining == 0)
     {
-        nrf_pwm_set_value(0, led_table[counter_illuminate]);
-        if (counter_illuminate < val_target_illuminate_pos)
-        {
-            counter_illuminate++;
-        } else {
-            counter_illuminate = 0;
-            is_led_illuminating = false;
-        }
+        p_channel->ticks = start_ticks;
+        (void)adc_scan_next();
     }
-
-    if (is_motor_running)
+    if (m_adc_burst_remaining > 0)
     {
-        nrf_pwm_set_value(1, motor_table[counter_motor]);
-        if (counter_motor < 14)
-        {
-            counter_motor++;
-        } else {
-            counter_motor = 0;
-            is_motor_running = false;
-        }
+        NRF_ADC->TASKS_START = 1;
+        adc_profile_add(start_ticks);
+        return;
     }
 
+    sd_ppi_channel_enable_clr(1 << ADC_PPI_CHANNEL);
+
     //Use the STOP task to save current. Workaround for PAN_028 rev1.5 anomaly 1.
     NRF_ADC->TASKS_STOP = 1;
     
     //Release the external crystal
     sd_clock_hfclk_release();
+    energy_stats_stop(&m_energy, ENERGY_HFCLK, start_ticks);
+
+    adc_profile_add(start_ticks);
 }   
 
 
@@ -260,6 +928,16 @@ static void timers_init(void)
                                 APP_TIMER_MODE_REPEATED,
                                 adc_sampling_timeout_handler);
     APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_led.timer_id,
+                                APP_TIMER_MODE_REPEATED,
+                                actuator_frame_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_motor.timer_id,
+                                APP_TIMER_MODE_REPEATED,
+                                actuator_frame_timeout_handler);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -322,6 +1000,350 @@ static void advertising_init(void)
 }
 
 
+/**@brief    Function for sending a reply to a command received over the Nordic UART Service.
+ *
+ * @details  Replies are dropped silently when no peer is connected or notifications are disabled.
+ */
+static void nus_reply(uint8_t * p_data, uint16_t length)
+{
+    uint32_t    err_code;
+
+    err_code = ble_nus_send_string(&m_nus, p_data, length);
+    if (err_code != NRF_ERROR_INVALID_STATE)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief    Function for handling the press detector configuration command.
+ *
+ * @details  'd' alone reads the configuration. 'd' followed by press depth, release depth (both
+ *           below the baseline), dwell time (ms) and refractory time (ms), each a little-endian u16,
+ *           writes it.
+ *           The reply always carries the active configuration in the same format.
+ */
+static void nus_detector_config_handle(uint8_t * p_data, uint16_t length)
+{
+    press_detector_config_t config = m_sensor.detector.config;
+    uint16_t                fields[4];
+    uint8_t                 reply[1 + sizeof(fields)];
+
+    if (length == sizeof(reply))
+    {
+        memcpy(fields, &p_data[1], sizeof(fields));
+        config.dwell_ticks       = MS_TO_TICKS(fields[2]);
+        config.refractory_ticks  = MS_TO_TICKS(fields[3]);
+        (void)sensor_pipeline_depth_set(&m_sensor, fields[0], fields[1]);
+        (void)press_detector_config_set(&m_sensor.detector, &config);
+    }
+
+    fields[0] = m_sensor.press_depth;
+    fields[1] = m_sensor.release_depth;
+    fields[2] = TICKS_TO_MS(m_sensor.detector.config.dwell_ticks);
+    fields[3] = TICKS_TO_MS(m_sensor.detector.config.refractory_ticks);
+    reply[0] = 'd';
+    memcpy(&reply[1], fields, sizeof(fields));
+    nus_reply(reply, sizeof(reply));
+}
+
+
+/**@brief    Function for handling the press detector statistics command.
+ *
+ * @details  Replies with 's', detections, rejected bounces, latency sample count and latency sum
+ *           (RTC1 ticks), each a little-endian u32, followed by the maximum latency as a u16, and
+ *           clears the statistics.
+ */
+static void nus_detector_stats_handle(void)
+{
+    press_detector_stats_t * p_stats = &m_sensor.detector.stats;
+    uint16_t                 latency_max;
+    uint8_t                  reply[19];
+
+    latency_max = (p_stats->latency_max_ticks > 0xFFFF) ? 0xFFFF : (uint16_t)p_stats->latency_max_ticks;
+    reply[0] = 's';
+    memcpy(&reply[1],  &p_stats->detections,        sizeof(uint32_t));
+    memcpy(&reply[5],  &p_stats->rejected_bounces,  sizeof(uint32_t));
+    memcpy(&reply[9],  &p_stats->latency_count,     sizeof(uint32_t));
+    memcpy(&reply[13], &p_stats->latency_sum_ticks, sizeof(uint32_t));
+    memcpy(&reply[17], &latency_max,                sizeof(uint16_t));
+    press_detector_stats_reset(&m_sensor.detector);
+    nus_reply(reply, sizeof(reply));
+}
+
+
+/**@brief    Function for handling the baseline tracker command.
+ *
+ * @details  'l' followed by a u8 sets the baseline averaging shift. The reply is 'l', the baseline,
+ *           the latest sensor value, the press and release thresholds (little-endian u16 each), the
+ *           averaging shift (u8), and the number of samples that updated and held the baseline
+ *           (little-endian u16 each, saturated).
+ */
+static void nus_baseline_handle(uint8_t * p_data, uint16_t length)
+{
+    baseline_tracker_t * p_baseline = &m_sensor.baseline;
+    uint16_t             fields[4];
+    uint16_t             counts[2];
+    uint8_t              reply[1 + sizeof(fields) + 1 + sizeof(counts)];
+
+    if (length == 2)
+    {
+        baseline_tracker_shift_set(p_baseline, p_data[1]);
+    }
+
+    fields[0] = baseline_tracker_get(p_baseline);
+    fields[1] = m_sensor.value;
+    fields[2] = m_sensor.detector.config.press_threshold;
+    fields[3] = m_sensor.detector.config.release_threshold;
+    counts[0] = (p_baseline->update_count > 0xFFFF) ? 0xFFFF : (uint16_t)p_baseline->update_count;
+    counts[1] = (p_baseline->hold_count > 0xFFFF) ? 0xFFFF : (uint16_t)p_baseline->hold_count;
+    reply[0] = 'l';
+    memcpy(&reply[1], fields, sizeof(fields));
+    reply[1 + sizeof(fields)] = p_baseline->shift;
+    memcpy(&reply[2 + sizeof(fields)], counts, sizeof(counts));
+    nus_reply(reply, sizeof(reply));
+}
+
+
+/**@brief    Function for handling the ADC channel read command.
+ *
+ * @details  Replies with 'a', the battery voltage in mV and the latest value of every scanned
+ *           channel, each a little-endian u16. No conversion is started.
+ */
+static void nus_adc_channels_handle(void)
+{
+    uint16_t    fields[1 + ADC_CHANNEL_COUNT];
+    uint8_t     reply[1 + sizeof(fields)];
+
+    fields[0] = (uint16_t)ADC_RESULT_TO_MV(m_adc_channels[ADC_CHANNEL_BATTERY].value);
+    for (uint8_t ch = 0; ch < ADC_CHANNEL_COUNT; ch++)
+    {
+        fields[1 + ch] = m_adc_channels[ch].value;
+    }
+    reply[0] = 'a';
+    memcpy(&reply[1], fields, sizeof(fields));
+    nus_reply(reply, sizeof(reply));
+}
+
+
+/**@brief    Function for playing a stored pattern on the actuator it was uploaded for.
+ *
+ * @details  Unknown IDs are ignored, as are all IDs while a pattern is being written.
+ *
+ * @param[in]   id          Pattern ID.
+ * @param[in]   policy      @ref anim_policy_t, ANIM_POLICY_COUNT for the default of the actuator.
+ */
+static void actuator_pattern_play(uint8_t id, uint8_t policy)
+{
+    const pattern_slot_t *  p_slot = pattern_store_get(id);
+    actuator_t *            p_actuator;
+
+    if (p_slot == NULL)
+    {
+        return;
+    }
+    p_actuator = (p_slot->header.target == PATTERN_TARGET_LED) ? &m_led : &m_motor;
+    if (policy >= ANIM_POLICY_COUNT)
+    {
+        policy = p_actuator->default_policy;
+    }
+    actuator_effect_submit(p_actuator, policy, p_slot->keyframes, p_slot->header.count, &p_slot->profile, true);
+}
+
+
+/**@brief    Function for handling the pattern upload command.
+ *
+ * @details  'u' followed by the pattern ID, the index of the first keyframe and up to 4 keyframes,
+ *           each a little-endian u16 duration (ms), a value and an interpolation, stages them.
+ *           Replies with 'u', the ID and the status (an NRF_ERROR code, 0 on success).
+ */
+static void nus_pattern_upload_handle(uint8_t * p_data, uint16_t length)
+{
+    uint32_t    err_code = NRF_ERROR_INVALID_LENGTH;
+    uint8_t     reply[3];
+
+    if ((length > 3) && (((length - 3) % sizeof(anim_keyframe_t)) == 0))
+    {
+        err_code = pattern_store_stage(p_data[1], p_data[2], &p_data[3], (length - 3) / sizeof(anim_keyframe_t));
+    }
+
+    reply[0] = 'u';
+    reply[1] = (length > 1) ? p_data[1] : 0;
+    reply[2] = (uint8_t)err_code;
+    nus_reply(reply, sizeof(reply));
+}
+
+
+/**@brief    Function for handling the pattern commit command.
+ *
+ * @details  'c' followed by the pattern ID, the target actuator (0: LED, 1: motor) and the number
+ *           of keyframes validates the staged pattern and writes it to flash, a count of 0 erases
+ *           the ID. Four more bytes optionally set the motor drive profile: kick-start level,
+ *           kick-start ms, brake ms and edge threshold, the default profile is stored otherwise.
+ *           Stored patterns stop playing during the write.
+ *           Replies with 'c', the ID and the status once the write has completed, or right away if
+ *           it could not be started.
+ */
+static void nus_pattern_commit_handle(uint8_t * p_data, uint16_t length)
+{
+    uint32_t                err_code = NRF_ERROR_INVALID_LENGTH;
+    motor_profile_config_t  profile  = m_motor_profile_default;
+    uint8_t                 reply[3];
+
+    if ((length == 4) || (length == 4 + sizeof(profile)))
+    {
+        if (length > 4)
+        {
+            profile.kick_level     = p_data[4];
+            profile.kick_ms        = p_data[5];
+            profile.brake_ms       = p_data[6];
+            profile.edge_threshold = p_data[7];
+        }
+        err_code = pattern_store_commit(p_data[1], p_data[2], p_data[3], &profile);
+        if (err_code == NRF_SUCCESS)
+        {
+            return;
+        }
+    }
+
+    reply[0] = 'c';
+    reply[1] = (length > 1) ? p_data[1] : 0;
+    reply[2] = (uint8_t)err_code;
+    nus_reply(reply, sizeof(reply));
+}
+
+
+/**@brief    Function for posting a command to the actuator context.
+ *
+ * @details  Commands that do not fit in the mailbox are dropped, the count is kept in its
+ *           overflow_count.
+ */
+static void actuator_cmd_post(const actuator_cmd_t * p_cmd)
+{
+    if (actuator_mailbox_put(&m_actuator_mailbox, p_cmd))
+    {
+        (void)sd_nvic_SetPendingIRQ(ACTUATOR_CMD_IRQn);
+    }
+}
+
+
+/**@brief    Function for handling the fill level configuration command.
+ *
+ * @details  'f' alone reads the configuration. 'f' followed by the capacity and the drain per
+ *           minute, both little-endian u16 in units of received value / 10, writes it; a zero
+ *           capacity is ignored. The LED follows the new configuration at once.
+ *           The reply always carries the active configuration in the same format, it is sent from
+ *           the actuator context by @ref actuator_fill_config_set.
+ */
+static void nus_fill_config_handle(uint8_t * p_data, uint16_t length)
+{
+    actuator_cmd_t  cmd;
+
+    cmd.type = ACTUATOR_CMD_FILL_CONFIG;
+    cmd.params.fill_config.capacity = 0;
+    if (length == 1 + sizeof(cmd.params.fill_config))
+    {
+        memcpy(&cmd.params.fill_config, &p_data[1], sizeof(cmd.params.fill_config));
+    }
+    actuator_cmd_post(&cmd);
+}
+
+
+/**@brief    Function for writing the fill level configuration and replying with the active one.
+ *
+ * @param[in]   capacity        Capacity, in units of received value / 10, 0 to only read.
+ * @param[in]   decay_per_min   Drain per minute, in the same units.
+ */
+static void actuator_fill_config_set(uint16_t capacity, uint16_t decay_per_min)
+{
+    fill_level_config_t config;
+    uint32_t            now_ticks;
+    uint16_t            fields[2];
+    uint8_t             reply[1 + sizeof(fields)];
+
+    if (capacity > 0)
+    {
+        config.capacity   = (uint32_t)capacity << FILL_LEVEL_FRAC_BITS;
+        config.decay_rate = FILL_DECAY_TO_RATE(decay_per_min);
+        app_timer_cnt_get(&now_ticks);
+        fill_level_config_set(&m_fill, &config, now_ticks);
+        led_level_show(false);
+    }
+
+    fields[0] = m_fill.config.capacity >> FILL_LEVEL_FRAC_BITS;
+    fields[1] = FILL_RATE_TO_DECAY(m_fill.config.decay_rate);
+    reply[0] = 'f';
+    memcpy(&reply[1], fields, sizeof(fields));
+    nus_reply(reply, sizeof(reply));
+}
+
+
+/**@brief    Function for handling the completion of a pattern commit.
+ */
+static void pattern_store_evt_handler(uint8_t id, uint32_t result)
+{
+    uint8_t     reply[3];
+
+    reply[0] = 'c';
+    reply[1] = id;
+    reply[2] = (uint8_t)result;
+    nus_reply(reply, sizeof(reply));
+}
+
+
+/**@brief    Function for running the commands posted by the BLE event handler.
+ *
+ * @details  Runs at the priority of the app_timer handlers, so the commands never interrupt a
+ *           pattern frame and a frame never interrupts a command.
+ */
+void ACTUATOR_CMD_IRQHandler(void)
+{
+    actuator_cmd_t  cmd;
+    uint32_t        now_ticks;
+
+    app_timer_cnt_get(&now_ticks);
+    energy_cpu_wake_mark(now_ticks);
+    while (actuator_mailbox_get(&m_actuator_mailbox, &cmd))
+    {
+        app_timer_cnt_get(&now_ticks);
+        switch (cmd.type)
+        {
+            case ACTUATOR_CMD_VALUE:
+                (void)fill_level_add(&m_fill, cmd.params.amount, now_ticks);
+                animation_start(true);
+                break;
+
+            case ACTUATOR_CMD_RESET:
+                fill_level_reset(&m_fill, now_ticks);
+                animation_start(false);
+                break;
+
+            case ACTUATOR_CMD_FILL_CONFIG:
+                actuator_fill_config_set(cmd.params.fill_config.capacity, cmd.params.fill_config.decay_per_min);
+                break;
+
+            case ACTUATOR_CMD_PATTERN_PLAY:
+                actuator_pattern_play(cmd.params.pattern.id, cmd.params.pattern.policy);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+
+/**@brief    Function for initializing the actuator command mailbox and its software interrupt.
+ */
+static void actuator_cmd_init(void)
+{
+    actuator_mailbox_init(&m_actuator_mailbox);
+    sd_nvic_ClearPendingIRQ(ACTUATOR_CMD_IRQn);
+    sd_nvic_SetPriority(ACTUATOR_CMD_IRQn, NRF_APP_PRIORITY_LOW);
+    sd_nvic_EnableIRQ(ACTUATOR_CMD_IRQn);
+}
+
+
 /**@brief    Function for handling the data from the Nordic UART Service.
  *
  * @details  This function will process the data received from the Nordic UART BLE Service and send
@@ -330,37 +1352,130 @@ static void advertising_init(void)
 /**@snippet [Handling the data received over BLE] */
 void nus_data_handler(ble_nus_t * p_nus, uint8_t * p_data, uint16_t length)
 {
+    actuator_cmd_t  cmd;
+
+    if ((length <= 2) && (p_data[0] & PATTERN_PLAY_CMD_FLAG))
+    {
+        cmd.type                  = ACTUATOR_CMD_PATTERN_PLAY;
+        cmd.params.pattern.id     = p_data[0] & ~PATTERN_PLAY_CMD_FLAG;
+        cmd.params.pattern.policy = (length == 2) ? p_data[1] : ANIM_POLICY_COUNT;
+        actuator_cmd_post(&cmd);
+        return;
+    }
+
+    if (p_data[0] == 'p')
+    {
+        // Report and reset the ADC CPU time profile: 'p', conversions (u32), RTC1 ticks (u32).
+        uint8_t     reply[9];
+
+        reply[0] = 'p';
+        CRITICAL_REGION_ENTER();
+        memcpy(&reply[1], &m_adc_profile_samples, sizeof(uint32_t));
+        memcpy(&reply[5], &m_adc_profile_cpu_ticks, sizeof(uint32_t));
+        m_adc_profile_samples = 0;
+        m_adc_profile_cpu_ticks = 0;
+        CRITICAL_REGION_EXIT();
+
+        nus_reply(reply, sizeof(reply));
+        return;
+    }
+
+    if (p_data[0] == 'q')
+    {
+        // Report and reset the queue high-water marks: 'q', event queue, actuator mailbox.
+        uint8_t     reply[3];
+
+        reply[0] = 'q';
+        reply[1] = evt_queue_high_water_get(&m_evt_queue);
+        reply[2] = actuator_mailbox_high_water_get(&m_actuator_mailbox);
+
+        nus_reply(reply, sizeof(reply));
+        return;
+    }
+
+    if (p_data[0] == 'd')
+    {
+        nus_detector_config_handle(p_data, length);
+        return;
+    }
+
+    if (p_data[0] == 's')
+    {
+        nus_detector_stats_handle();
+        return;
+    }
+
+    if (p_data[0] == 'l')
+    {
+        nus_baseline_handle(p_data, length);
+        return;
+    }
+
+    if (p_data[0] == 'a')
+    {
+        nus_adc_channels_handle();
+        return;
+    }
+
+    if (p_data[0] == 'u')
+    {
+        nus_pattern_upload_handle(p_data, length);
+        return;
+    }
+
+    if (p_data[0] == 'c')
+    {
+        nus_pattern_commit_handle(p_data, length);
+        return;
+    }
+
+    if (p_data[0] == 'f')
+    {
+        nus_fill_config_handle(p_data, length);
+        return;
+    }
+
     if (p_data[0] == 'b')
     {
-        counter_illuminate = val_target_illuminate_pos;
-        val_target_illuminate_pos = 49;
         val_rcvd_ble = 0;
-        val_total_stored = 0.0;
-        is_led_illuminating = true;
-        is_motor_running = true;
+        cmd.type = ACTUATOR_CMD_RESET;
+        actuator_cmd_post(&cmd);
 
         return;
     }
 
-    val_rcvd_ble = atoi((char*)p_data);
-    val_total_stored += (float)val_rcvd_ble/10.0;
-    
-    for (val_target_illuminate_pos = 0; val_target_illuminate_pos < 49; val_target_illuminate_pos++)
+    val_rcvd_ble = rx_value_parse(p_data, length);
+    cmd.type          = ACTUATOR_CMD_VALUE;
+    cmd.params.amount = RX_VALUE_TO_FILL(val_rcvd_ble);
+    actuator_cmd_post(&cmd);
+
+    nus_reply(p_data, length);
+}
+
+
+/**@brief    Function for filling in the Diagnostics characteristic on a read.
+ *
+ * @details  The value is the time covered by the counters followed by the on-time of HFCLK, CPU,
+ *           PWM and ADC, each in RTC1 ticks as a little-endian u32.
+ */
+static uint16_t nus_diag_handler(ble_nus_t * p_nus, uint8_t * p_data, uint16_t max_length)
+{
+    uint32_t    now_ticks;
+    uint16_t    length = sizeof(uint32_t) * (1 + ENERGY_COUNT);
+
+    if (max_length < length)
     {
-        if (led_table[val_target_illuminate_pos] <= val_total_stored)
-        {
-            break;
-        }
+        return 0;
     }
-    is_led_illuminating = true;
-    is_motor_running = true;
 
-    uint32_t    err_code;
-    err_code = ble_nus_send_string(&m_nus, p_data, length);
-    if (err_code != NRF_ERROR_INVALID_STATE)
-    {   
-        APP_ERROR_CHECK(err_code);
-    }
+    // The counters are also updated from interrupt context, copy a consistent set.
+    CRITICAL_REGION_ENTER();
+    app_timer_cnt_get(&now_ticks);
+    energy_stats_update(&m_energy, now_ticks);
+    memcpy(&p_data[0], &m_energy.elapsed_ticks, sizeof(uint32_t));
+    memcpy(&p_data[sizeof(uint32_t)], m_energy.total_ticks, sizeof(m_energy.total_ticks));
+    CRITICAL_REGION_EXIT();
+    return length;
 }
 
 
@@ -374,6 +1489,7 @@ static void services_init(void)
     memset(&nus_init, 0, sizeof(nus_init));
 
     nus_init.data_handler = nus_data_handler;
+    nus_init.diag_handler = nus_diag_handler;
     
     err_code = ble_nus_init(&m_nus, &nus_init);
     APP_ERROR_CHECK(err_code);
@@ -540,22 +1656,82 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
 }
 
 
+/**@brief       Function for queueing an event for the main loop.
+ *
+ * @details     The queue is sized from its high-water mark, an event that does not fit is an error
+ *              like a full app_scheduler queue.
+ */
+static void main_evt_put(const void * p_data, uint16_t size, evt_queue_handler_t handler)
+{
+    if (!evt_queue_put(&m_evt_queue, p_data, size, handler))
+    {
+        APP_ERROR_CHECK(NRF_ERROR_NO_MEM);
+    }
+}
+
+
 /**@brief       Function for dispatching a S110 SoftDevice event to all modules with a S110
  *              SoftDevice event handler.
  *
- * @details     This function is called from the S110 SoftDevice event interrupt handler after a
- *              S110 SoftDevice event has been received.
+ * @details     This function is called from the main loop with the events queued by
+ *              @ref ble_evt_dispatch.
  *
- * @param[in]   p_ble_evt   S110 SoftDevice event.
+ * @param[in]   p_data      S110 SoftDevice event.
+ * @param[in]   size        Size of the event.
  */
-static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
+static void ble_evt_execute(void * p_data, uint16_t size)
 {
+    ble_evt_t * p_ble_evt = (ble_evt_t *)p_data;
+
     ble_conn_params_on_ble_evt(p_ble_evt);
     ble_nus_on_ble_evt(&m_nus, p_ble_evt);
     on_ble_evt(p_ble_evt);
 }
 
 
+/**@brief       Function for deferring a S110 SoftDevice event to the main loop.
+ *
+ * @details     This function is called from the S110 SoftDevice event interrupt handler after a
+ *              S110 SoftDevice event has been received. Only the event is copied here, parsing
+ *              and acting on it is left to the main loop.
+ *
+ * @param[in]   p_ble_evt   S110 SoftDevice event.
+ */
+static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
+{
+    uint32_t now_ticks;
+
+    app_timer_cnt_get(&now_ticks);
+    energy_cpu_wake_mark(now_ticks);
+    main_evt_put(p_ble_evt, sizeof(ble_evt_hdr_t) + p_ble_evt->header.evt_len, ble_evt_execute);
+}
+
+
+/**@brief   Function for dispatching a system event to the modules with a system event handler.
+ *
+ * @details Called from the main loop with the events queued by @ref sys_evt_dispatch.
+ */
+static void sys_evt_execute(void * p_data, uint16_t size)
+{
+    pstorage_sys_event_handler(*(uint32_t *)p_data);
+    nrf_pwm_sys_event_handler(*(uint32_t *)p_data);
+}
+
+
+/**@brief   Function for deferring a system event to the main loop.
+ *
+ * @param[in]   sys_evt     System event.
+ */
+static void sys_evt_dispatch(uint32_t sys_evt)
+{
+    uint32_t now_ticks;
+
+    app_timer_cnt_get(&now_ticks);
+    energy_cpu_wake_mark(now_ticks);
+    main_evt_put(&sys_evt, sizeof(sys_evt), sys_evt_execute);
+}
+
+
 /**@brief   Function for the S110 SoftDevice initialization.
  *
  * @details This function initializes the S110 SoftDevice and the BLE event interrupt.
@@ -577,6 +1753,10 @@ static void ble_stack_init(void)
     // Subscribe for BLE events.
     err_code = softdevice_ble_evt_handler_set(ble_evt_dispatch);
     APP_ERROR_CHECK(err_code);
+
+    // Subscribe for system events, flash operations complete through them.
+    err_code = softdevice_sys_evt_handler_set(sys_evt_dispatch);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -589,23 +1769,54 @@ static void power_manage(void)
 }
 
 
+/**@brief  Function for accounting the main loop as awake or about to sleep.
+ *
+ * @details CPU time is only measured here: the CPU is awake except from just before
+ *          sd_app_evt_wait until the first application handler marks the wake-up, or until
+ *          sd_app_evt_wait returns if no application handler ran. Interrupt handlers are thereby
+ *          counted once, whether they interrupt the main loop or wake it. The timestamp is taken
+ *          inside the critical region so that an interrupt cannot start or stop a counter with a
+ *          later timestamp in between.
+ */
+static void energy_cpu_awake_set(bool is_awake)
+{
+    uint32_t now_ticks;
+
+    CRITICAL_REGION_ENTER();
+    app_timer_cnt_get(&now_ticks);
+    if (is_awake)
+    {
+        energy_cpu_wake_mark(now_ticks);
+        energy_stats_start(&m_energy, ENERGY_CPU, m_cpu_wake_ticks);
+    }
+    else
+    {
+        energy_stats_update(&m_energy, now_ticks);
+        energy_stats_stop(&m_energy, ENERGY_CPU, now_ticks);
+        m_cpu_is_sleeping = true;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
 /**@brief  Application main function.
  */
 int main(void)
 {
+    uint32_t            err_code;
+    uint32_t            now_ticks;
+    fill_level_config_t fill_config = {.capacity   = (uint32_t)FILL_CAPACITY << FILL_LEVEL_FRAC_BITS,
+                                       .decay_rate = FILL_DECAY_TO_RATE(FILL_DECAY_PER_MIN)};
+
     // Initialize
     val_rcvd_ble = 0;
-    val_adc_result = 0;
-    val_total_stored = 0;
-    val_target_illuminate_pos = 0;
-    counter_illuminate = 0;
     is_val_rcvd_ble = false;
-    is_sensor_reacting = false;
-    is_led_illuminating = false;
-    counter_motor = 0;
-    is_motor_running = false;
+    anim_mixer_init(&m_led.mixer, 0);
+    anim_mixer_init(&m_motor.mixer, 0);
+    motor_profile_init(&m_motor.drive);
 
     timers_init();
+    evt_queue_init(&m_evt_queue, m_evt_queue_buffer, MAIN_EVT_DATA_SIZE);
     ble_stack_init();
     gap_params_init();
     services_init();
@@ -614,15 +1825,26 @@ int main(void)
     sec_params_init();
 
     adc_init();
+    actuator_cmd_init();
+
+    err_code = pstorage_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = pattern_store_init(pattern_store_evt_handler);
+    APP_ERROR_CHECK(err_code);
 
     nrf_pwm_config_t pwm_config = PWM_DEFAULT_CONFIG;
-    pwm_config.mode = PWM_MODE_LED_255;
-    pwm_config.num_channels = 2;
+    pwm_config.mode = LED_CURVE_PWM_MODE;
+    pwm_config.num_channels = PWM_CHANNEL_COUNT;
     pwm_config.gpio_num[0] = LED_PIN;
     pwm_config.gpio_num[1] = MOTOR_PIN;
     nrf_pwm_init(&pwm_config);
-    nrf_pwm_set_value(0, 0);
-    nrf_pwm_set_value(1, 0);
+    // Keep the PWM timer stopped until an output is switched on.
+    nrf_pwm_set_enabled(false);
+
+    app_timer_cnt_get(&now_ticks);
+    energy_stats_init(&m_energy, now_ticks);
+    m_cpu_wake_ticks = now_ticks;
+    fill_level_init(&m_fill, &fill_config, now_ticks);
     
     application_timers_start();
     advertising_start();
@@ -630,6 +1852,12 @@ int main(void)
     // Enter main loop
     for (;;)
     {
+        energy_cpu_awake_set(true);
+        evt_queue_execute(&m_evt_queue);
+        adc_samples_process();
+        adc_sampling_rate_update();
+        energy_cpu_awake_set(false);
+
         power_manage();
     }
 }
@@ -0,0 +1,23 @@
+/**@file
+ *
+ * @brief    Barrier between the data and the index update of the single-producer rings
+ *           (adc_filter, actuator_mailbox, evt_queue).
+ *
+ * @details  The producer writes an entry and then advances the head, the consumer reads it and
+ *           then advances the tail. The indexes are volatile, the entries are not, so without a
+ *           barrier the compiler may move the entry access across the index update. The
+ *           Cortex-M0 executes in order on a single core, so only the compiler has to be stopped.
+ *           A host build may run the producer and the consumer on cores that reorder memory
+ *           accesses (test/), there it is a full fence.
+ */
+
+#ifndef MEMORY_BARRIER_H__
+#define MEMORY_BARRIER_H__
+
+#if defined(__ARM_ARCH_6M__)
+#define MEMORY_BARRIER()        __asm__ volatile ("" ::: "memory")
+#else
+#define MEMORY_BARRIER()        __sync_synchronize()
+#endif
+
+#endif // MEMORY_BARRIER_H__
@@ -0,0 +1,73 @@
+#include "motor_profile.h"
+#include <stddef.h>
+
+
+/**@brief   Function for scaling a full-step time in ms by a step size, to ticks. */
+static uint32_t step_ticks_get(uint8_t full_ms, uint8_t step)
+{
+    return ((uint32_t)full_ms * step * MOTOR_PROFILE_TICKS_PER_SECOND) / (1000UL * 255);
+}
+
+
+/**@brief   Function for counting down a remaining time. */
+static uint32_t remaining_update(uint32_t remaining_ticks, uint32_t elapsed_ticks)
+{
+    return (elapsed_ticks >= remaining_ticks) ? 0 : (remaining_ticks - elapsed_ticks);
+}
+
+
+void motor_profile_init(motor_profile_t * p_profile)
+{
+    p_profile->target      = 0;
+    p_profile->kick_ticks  = 0;
+    p_profile->brake_ticks = 0;
+}
+
+
+uint8_t motor_profile_apply(motor_profile_t              * p_profile,
+                            const motor_profile_config_t * p_config,
+                            uint8_t                        target,
+                            bool                           is_step,
+                            uint32_t                       elapsed_ticks)
+{
+    uint8_t previous = p_profile->target;
+
+    p_profile->kick_ticks  = remaining_update(p_profile->kick_ticks, elapsed_ticks);
+    p_profile->brake_ticks = remaining_update(p_profile->brake_ticks, elapsed_ticks);
+    p_profile->target      = target;
+
+    if (p_config == NULL)
+    {
+        p_profile->kick_ticks  = 0;
+        p_profile->brake_ticks = 0;
+        return target;
+    }
+
+    // A new step cancels whatever the previous one started, a fade never starts one.
+    if (is_step && (target > previous) && (target - previous >= p_config->edge_threshold))
+    {
+        p_profile->kick_ticks  = step_ticks_get(p_config->kick_ms, target - previous);
+        p_profile->brake_ticks = 0;
+    }
+    else if (is_step && (target < previous) && (previous - target >= p_config->edge_threshold))
+    {
+        p_profile->kick_ticks  = 0;
+        p_profile->brake_ticks = step_ticks_get(p_config->brake_ms, previous - target);
+    }
+
+    if (p_profile->brake_ticks > 0)
+    {
+        return 0;
+    }
+    if ((p_profile->kick_ticks > 0) && (target > 0) && (target < p_config->kick_level))
+    {
+        return p_config->kick_level;
+    }
+    return target;
+}
+
+
+bool motor_profile_is_active(const motor_profile_t * p_profile)
+{
+    return (p_profile->kick_ticks > 0) || (p_profile->brake_ticks > 0);
+}
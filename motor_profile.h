@@ -0,0 +1,81 @@
+/**@file
+ *
+ * @defgroup motor_profile Motor drive profile
+ * @{
+ * @brief    Shapes the motor drive around steps of the requested level.
+ *
+ * @details  A vibration motor needs tens of ms to spin up and coasts for a similar time when the
+ *           drive is reduced. On a rising step of at least edge_threshold the drive is held at
+ *           kick_level or above for a kick-start time, and on a falling step it is cut to zero for
+ *           a brake time before settling on the new level. Both times are scaled by the size of the
+ *           step relative to full scale, so small steps get short pulses.
+ *
+ *           Steps are the jumps of the pattern, told by the caller. A fade is never a step, even
+ *           when the caller is advanced rarely enough that it changes by more than edge_threshold
+ *           between two calls, so the drive does not depend on the frame rate.
+ *
+ *           The motor is driven by a single transistor, so braking is a zero-drive interval rather
+ *           than reverse drive.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef MOTOR_PROFILE_H__
+#define MOTOR_PROFILE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MOTOR_PROFILE_TICKS_PER_SECOND  32768                        /**< Time base of the profile, RTC1 with prescaler 0. */
+
+/**@brief   Drive profile parameters, 4 bytes, stored with each pattern. */
+typedef struct
+{
+    uint8_t                  kick_level;              /**< Minimum drive during the kick-start. */
+    uint8_t                  kick_ms;                 /**< Kick-start time for a full-scale rising step, 0 disables it. */
+    uint8_t                  brake_ms;                /**< Zero-drive time for a full-scale falling step, 0 disables it. */
+    uint8_t                  edge_threshold;          /**< Smallest step that gets a kick-start or brake. */
+} motor_profile_config_t;
+
+/**@brief   Drive profile state. */
+typedef struct
+{
+    uint8_t                  target;                  /**< Level requested by the previous call. */
+    uint32_t                 kick_ticks;              /**< Kick-start time left. */
+    uint32_t                 brake_ticks;             /**< Brake time left. */
+} motor_profile_t;
+
+/**@brief       Function for initializing the profile state.
+ *
+ * @param[out]  p_profile   Profile state.
+ */
+void motor_profile_init(motor_profile_t * p_profile);
+
+/**@brief       Function for computing the drive for a requested level.
+ *
+ * @param[in]   p_profile       Profile state.
+ * @param[in]   p_config        Profile parameters, NULL passes the level through.
+ * @param[in]   target          Requested level.
+ * @param[in]   is_step         The change from the previous level contains a jump of the pattern,
+ *                              see @ref anim_mixer_advance. Without it the change is a fade.
+ * @param[in]   elapsed_ticks   Time since the previous call.
+ *
+ * @return      Drive level.
+ */
+uint8_t motor_profile_apply(motor_profile_t              * p_profile,
+                            const motor_profile_config_t * p_config,
+                            uint8_t                        target,
+                            bool                           is_step,
+                            uint32_t                       elapsed_ticks);
+
+/**@brief       Function for checking whether a kick-start or brake is in progress.
+ *
+ * @param[in]   p_profile   Profile state.
+ *
+ * @return      true while the drive differs from the requested level.
+ */
+bool motor_profile_is_active(const motor_profile_t * p_profile);
+
+#endif // MOTOR_PROFILE_H__
+
+/** @} */
@@ -4,19 +4,34 @@
 #include "nrf_gpio.h"
 #if(USE_WITH_SOFTDEVICE == 1)
 #include "nrf_sdm.h"
+#include "nrf_soc.h"
 #endif
 
-static uint32_t pwm_max_value, pwm_next_value[PWM_MAX_CHANNELS], pwm_next_max_value, pwm_io_ch[PWM_MAX_CHANNELS], pwm_running[PWM_MAX_CHANNELS];
-static bool pwm_modified[PWM_MAX_CHANNELS];
+#if(PWM_RTC_ENABLED == 1) && (USE_WITH_SOFTDEVICE == 1) && (PWM_RTC_INSTANCE == 0)
+#error "RTC0 is reserved by the SoftDevice, the RTC backend needs PWM_RTC_INSTANCE 1"
+#endif
+
+static uint32_t pwm_max_value, pwm_next_max_value, pwm_io_ch[PWM_MAX_CHANNELS], pwm_running[PWM_MAX_CHANNELS];
+// Written by the application, read by the update interrupt or timeslot. Volatile, so the flag is always cleared
+// before the value is read and set after it is written
+static volatile uint32_t pwm_next_value[PWM_MAX_CHANNELS];
+static volatile bool pwm_modified[PWM_MAX_CHANNELS];
 static uint8_t pwm_gpiote_channel[PWM_MAX_CHANNELS];
 static uint32_t pwm_num_channels;
+// Timer ticks a channel update may take, about 5us. An update is not started this close to the end of the period
 static uint32_t pwm_cc_update_margin_ticks = 10;
 static const uint8_t pwm_cc_margin_by_prescaler[] = {80, 40, 20, 10, 5, 2, 1, 1, 1, 1};
+static volatile bool pwm_update_pending, pwm_timer_running;
+static volatile uint32_t pwm_update_hold;
+#if(PWM_SEQ_ENABLED == 1)
+static bool pwm_seq_available, pwm_seq_loop;
+static volatile bool pwm_seq_running;
+static const uint16_t *pwm_seq_values;
+static uint32_t pwm_seq_channel_mask, pwm_seq_num_values, pwm_seq_step_count, pwm_seq_index;
+#endif
+static uint32_t pwm_rtc_channel_mask;
 
-#define PWM_TIMER_CURRENT  PWM_TIMER->CC[3]
-#define PWM_TIMER2_CURRENT PWM_TIMER2->CC[3]
-
-void PWM_IRQHandler(void);
+static bool pwm_update_apply(void);
 
 static void apply_pan73_workaround(NRF_TIMER_Type *timer, bool enable)
 {
@@ -34,20 +49,6 @@ static void apply_pan73_workaround(NRF_TIMER_Type *timer, bool enable)
     }
 }
 
-static __INLINE bool safe_margins_present(uint32_t timer_state, uint32_t compare_state)  // Approx runtime ~2us
-{
-    if(compare_state <= pwm_cc_update_margin_ticks)
-    {
-        if(timer_state >= compare_state && timer_state < (pwm_max_value + compare_state - pwm_cc_update_margin_ticks)) return true;
-        else return false;
-    }
-    else
-    {
-        if(timer_state < (compare_state - pwm_cc_update_margin_ticks) || timer_state >= compare_state) return true;
-        else return false;
-    }
-}
-
 static void ppi_enable_channel(uint32_t ch_num, volatile uint32_t *event_ptr, volatile uint32_t *task_ptr)
 {
     if(ch_num >= 16) return;
@@ -65,7 +66,27 @@ static void ppi_enable_channel(uint32_t ch_num, volatile uint32_t *event_ptr, vo
     }
 }
 
+// Only the sequencer and the RTC backend take an interrupt with a SoftDevice
+#if(USE_WITH_SOFTDEVICE == 0) || (PWM_SEQ_ENABLED == 1) || (PWM_RTC_ENABLED == 1)
+static void irq_enable(IRQn_Type irq, uint32_t priority)
+{
 #if(USE_WITH_SOFTDEVICE == 1)
+    sd_nvic_SetPriority(irq, priority);
+    sd_nvic_EnableIRQ(irq);
+#else
+    NVIC_SetPriority(irq, priority);
+    NVIC_EnableIRQ(irq);
+#endif
+}
+#endif
+
+#if(USE_WITH_SOFTDEVICE == 1)
+static nrf_radio_request_t pwm_radio_request = {.request_type = NRF_RADIO_REQ_TYPE_EARLIEST,
+                                                .params.earliest = {.hfclk      = NRF_RADIO_HFCLK_CFG_DEFAULT,
+                                                                    .priority   = NRF_RADIO_PRIORITY_HIGH,
+                                                                    .length_us  = 250,
+                                                                    .timeout_us = 100000}};
+
 nrf_radio_signal_callback_return_param_t *nrf_radio_signal_callback(uint8_t signal_type)
 {
     static nrf_radio_signal_callback_return_param_t return_params;
@@ -73,7 +94,15 @@ nrf_radio_signal_callback_return_param_t *nrf_radio_signal_callback(uint8_t sign
     switch(signal_type)
     {
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_START:            /**< This signal indicates the start of the radio timeslot. */
-            PWM_IRQHandler();
+            // Cleared first, so a value modified from here on gets a timeslot of its own
+            pwm_update_pending = false;
+            if(!pwm_update_apply())
+            {
+                // A channel was caught at the end of the period, the next timeslot applies it
+                pwm_update_pending = true;
+                return_params.params.request.p_next = &pwm_radio_request;
+                return_params.callback_action = NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END;
+            }
             break;
         case NRF_RADIO_CALLBACK_SIGNAL_TYPE_TIMER0:            /**< This signal indicates the NRF_TIMER0 interrupt. */
             break;
@@ -88,9 +117,109 @@ nrf_radio_signal_callback_return_param_t *nrf_radio_signal_callback(uint8_t sign
 }  
 #endif
 
+// Gets pwm_update_apply to apply the modified values, in a radio timeslot or at the next period boundary.
+// A timeslot applies every channel modified before it starts, so at most one is requested at a time
+// and a frame updating several channels, in one or several calls, costs a single timeslot
+static void pwm_update_request(void)
+{
+    uint32_t modified_mask = 0;
+    for(uint32_t i = 0; i < pwm_num_channels; i++)
+    {
+        if(pwm_modified[i]) modified_mask |= (1 << i);
+    }
+#if(PWM_RTC_ENABLED == 1)
+    if(modified_mask & pwm_rtc_channel_mask)
+    {
+        PWM_RTC->EVENTS_COMPARE[0] = 0;
+        PWM_RTC->INTENSET = RTC_INTENSET_COMPARE0_Msk;
+    }
+#endif
+    // Only RTC channels modified, the timers and the HFCLK are left alone
+    if((modified_mask & ~pwm_rtc_channel_mask) == 0) return;
+#if(USE_WITH_SOFTDEVICE == 1)
+    if(pwm_update_pending) return;
+    pwm_update_pending = true;
+    sd_radio_request(&pwm_radio_request);
+#else
+    if(pwm_timer_running)
+    {
+        // The event is set every period, only a new one may trigger the interrupt
+        PWM_TIMER->EVENTS_COMPARE[2] = 0;
+        PWM_TIMER->INTENSET = TIMER_INTENSET_COMPARE2_Msk;
+    }
+    else
+    {
+        // The counter is frozen, the values can be applied right away
+        NVIC_SetPendingIRQ(PWM_IRQn);
+    }
+#endif
+}
+
+#if(PWM_SEQ_ENABLED == 1)
+// Loads the current step of the sequence and moves to the next one
+static void pwm_seq_step_load(void)
+{
+    const uint16_t *step = &pwm_seq_values[pwm_seq_index * pwm_seq_num_values];
+    for(uint32_t i = 0; i < pwm_num_channels; i++)
+    {
+        if(pwm_seq_channel_mask & (1 << i))
+        {
+            pwm_next_value[i] = *step++;
+            pwm_modified[i] = true;
+        }
+    }
+    pwm_update_request();
+    if(++pwm_seq_index >= pwm_seq_step_count)
+    {
+        if(pwm_seq_loop) pwm_seq_index = 0;
+        else nrf_pwm_sequence_stop();
+    }
+}
+#endif
+
+// Starts the timers on consecutive instructions. They run from the same clock with the same period,
+// so from a cleared state their periods stay in phase, a fraction of a tick apart
+static void pwm_timers_start(void)
+{
+    PWM_TIMER->TASKS_START = 1;
+    if(pwm_num_channels > 2) PWM_TIMER2->TASKS_START = 1;
+    pwm_timer_running = true;
+}
+
+#if(PWM_RTC_ENABLED == 1)
+// The RTC counts at 32768Hz and is cleared at the end of each period, which toggles the RTC channels high.
+// Each one is toggled low by its own compare register, CC[1 + channel]
+static void pwm_rtc_init(nrf_pwm_config_t *config)
+{
+    PWM_RTC->TASKS_STOP = 1;
+    PWM_RTC->TASKS_CLEAR = 1;
+    PWM_RTC->PRESCALER = 0;
+    PWM_RTC->CC[0] = PWM_RTC_PERIOD_TICKS - 1;
+    PWM_RTC->EVENTS_COMPARE[0] = 0;
+    PWM_RTC->EVTENSET = RTC_EVTEN_COMPARE0_Msk;
+    ppi_enable_channel(config->ppi_channel[PWM_RTC_PPI_INDEX], &PWM_RTC->EVENTS_COMPARE[0], &PWM_RTC->TASKS_CLEAR);
+    for(uint32_t i = 0; i < pwm_num_channels; i++)
+    {
+        if(!(pwm_rtc_channel_mask & (1 << i))) continue;
+        PWM_RTC->EVTENSET = (RTC_EVTEN_COMPARE1_Msk << i);
+        ppi_enable_channel(config->ppi_channel[i*2],  &PWM_RTC->EVENTS_COMPARE[1 + i], &NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]]);
+        ppi_enable_channel(config->ppi_channel[i*2+1],&PWM_RTC->EVENTS_COMPARE[0], &NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]]);
+    }
+    irq_enable(PWM_RTC_IRQn, PWM_RTC_IRQ_PRIORITY);
+    PWM_RTC->TASKS_START = 1;
+}
+#endif
+
 uint32_t nrf_pwm_init(nrf_pwm_config_t *config)
 {
     if(config->num_channels == 0 || config->num_channels > PWM_MAX_CHANNELS) return 0xFFFFFFFF;
+#if(PWM_RTC_ENABLED == 1)
+    if(config->rtc_channel_mask >= (1 << config->num_channels)) return 0xFFFFFFFF;
+    if(config->rtc_channel_mask != 0 && config->num_channels > 2) return 0xFFFFFFFF;
+    pwm_rtc_channel_mask = config->rtc_channel_mask;
+#else
+    if(config->rtc_channel_mask != 0) return 0xFFFFFFFF;
+#endif
     
     switch(config->mode)
     {
@@ -122,6 +251,9 @@ uint32_t nrf_pwm_init(nrf_pwm_config_t *config)
             return 0xFFFFFFFF;
     }
     pwm_cc_update_margin_ticks = pwm_cc_margin_by_prescaler[PWM_TIMER->PRESCALER];
+#ifdef PWM_UPDATE_PROFILE_PIN
+    nrf_gpio_cfg_output(PWM_UPDATE_PROFILE_PIN);
+#endif
     pwm_num_channels = config->num_channels;
     for(int i = 0; i < pwm_num_channels; i++)
     {
@@ -150,9 +282,10 @@ uint32_t nrf_pwm_init(nrf_pwm_config_t *config)
 
     for(int i = 0; i < pwm_num_channels && i < 2; i++)
     {
+        pwm_modified[i] = false;
+        if(pwm_rtc_channel_mask & (1 << i)) continue;
         ppi_enable_channel(config->ppi_channel[i*2],  &PWM_TIMER->EVENTS_COMPARE[i], &NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]]);
         ppi_enable_channel(config->ppi_channel[i*2+1],&PWM_TIMER->EVENTS_COMPARE[2], &NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]]);  
-        pwm_modified[i] = false;        
     }
     for(int i = 2; i < pwm_num_channels; i++)
     {
@@ -160,19 +293,35 @@ uint32_t nrf_pwm_init(nrf_pwm_config_t *config)
         ppi_enable_channel(config->ppi_channel[i*2+1],&PWM_TIMER2->EVENTS_COMPARE[2], &NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]]);  
         pwm_modified[i] = false;        
     }
+#if(PWM_SEQ_ENABLED == 1)
+    // With 1-2 channels the second timer counts PWM periods for the waveform sequencer
+    pwm_seq_available = (pwm_num_channels <= 2);
+    if(pwm_seq_available)
+    {
+        PWM_SEQ_TIMER->TASKS_STOP = 1;
+        PWM_SEQ_TIMER->TASKS_CLEAR = 1;
+        PWM_SEQ_TIMER->MODE = TIMER_MODE_MODE_Counter;
+        PWM_SEQ_TIMER->BITMODE = TIMER_BITMODE_BITMODE_16Bit;
+        PWM_SEQ_TIMER->SHORTS = TIMER_SHORTS_COMPARE0_CLEAR_Msk;
+        PWM_SEQ_TIMER->EVENTS_COMPARE[0] = 0;
+        PWM_SEQ_TIMER->INTENSET = TIMER_INTENSET_COMPARE0_Msk;
+        ppi_enable_channel(config->ppi_channel[PWM_SEQ_PPI_INDEX], &PWM_TIMER->EVENTS_COMPARE[2], &PWM_SEQ_TIMER->TASKS_COUNT);
+        irq_enable(PWM_SEQ_IRQn, PWM_SEQ_IRQ_PRIORITY);
+    }
+#endif
 #if(USE_WITH_SOFTDEVICE == 1)
+    pwm_update_pending = false;
     sd_radio_session_open(nrf_radio_signal_callback);
 #else
-    NVIC_SetPriority(PWM_IRQn, 0);
-    NVIC_EnableIRQ(PWM_IRQn);
+    irq_enable(PWM_IRQn, PWM_IRQ_PRIORITY);
+#endif
+#if(PWM_RTC_ENABLED == 1)
+    if(pwm_rtc_channel_mask != 0) pwm_rtc_init(config);
 #endif
     apply_pan73_workaround(PWM_TIMER, true);
-    PWM_TIMER->TASKS_START = 1;
-    if(pwm_num_channels > 2)
-    {
-        apply_pan73_workaround(PWM_TIMER2, true);
-        PWM_TIMER2->TASKS_START = 1;
-    }
+    if(pwm_num_channels > 2) apply_pan73_workaround(PWM_TIMER2, true);
+    // With every channel on the RTC the timers only run once nrf_pwm_set_enabled starts them
+    if(pwm_rtc_channel_mask != (1 << pwm_num_channels) - 1) pwm_timers_start();
     return 0;
 }
 
@@ -180,37 +329,34 @@ void nrf_pwm_set_value(uint32_t pwm_channel, uint32_t pwm_value)
 {
     pwm_next_value[pwm_channel] = pwm_value;
     pwm_modified[pwm_channel] = true;
-#if(USE_WITH_SOFTDEVICE == 1)
-    nrf_radio_request_t radio_request;
-    radio_request.request_type = NRF_RADIO_REQ_TYPE_EARLIEST;
-    radio_request.params.earliest.hfclk = NRF_RADIO_HFCLK_CFG_DEFAULT;
-    radio_request.params.earliest.length_us = 250;
-    radio_request.params.earliest.priority = NRF_RADIO_PRIORITY_HIGH;
-    radio_request.params.earliest.timeout_us = 100000;
-    sd_radio_request(&radio_request);
-#else
-    NVIC_SetPendingIRQ(PWM_IRQn);
-#endif
+    // Inside a transaction only the commit requests the update, so it costs a single timeslot
+    if(pwm_update_hold == 0) pwm_update_request();
 }
  
 void nrf_pwm_set_values(uint32_t pwm_channel_num, uint32_t *pwm_values)
 {
+    nrf_pwm_update_begin();
     for(int i = 0; i < pwm_channel_num; i++)
     {
-        pwm_next_value[i] = pwm_values[i];
-        pwm_modified[i] = true;
+        nrf_pwm_update_stage(i, pwm_values[i]);
     }
-#if(USE_WITH_SOFTDEVICE == 1)
-    nrf_radio_request_t radio_request;
-    radio_request.request_type = NRF_RADIO_REQ_TYPE_EARLIEST;
-    radio_request.params.earliest.hfclk = NRF_RADIO_HFCLK_CFG_DEFAULT;
-    radio_request.params.earliest.length_us = 250;
-    radio_request.params.earliest.priority = NRF_RADIO_PRIORITY_HIGH;
-    radio_request.params.earliest.timeout_us = 100000;
-    sd_radio_request(&radio_request);
-#else
-    NVIC_SetPendingIRQ(PWM_IRQn);
-#endif
+    nrf_pwm_update_commit();
+}
+
+void nrf_pwm_update_begin(void)
+{
+    pwm_update_hold++;
+}
+
+void nrf_pwm_update_stage(uint32_t pwm_channel, uint32_t pwm_value)
+{
+    pwm_next_value[pwm_channel] = pwm_value;
+    pwm_modified[pwm_channel] = true;
+}
+
+void nrf_pwm_update_commit(void)
+{
+    if(pwm_update_hold > 0 && --pwm_update_hold == 0) pwm_update_request();
 }
 
 void nrf_pwm_set_max_value(uint32_t max_value)
@@ -218,19 +364,72 @@ void nrf_pwm_set_max_value(uint32_t max_value)
     pwm_next_max_value = max_value;
 }
 
+#define PWM_TIMER_BASE_FREQUENCY    16000000UL
+#define PWM_PRESCALER_MAX           (sizeof(pwm_cc_margin_by_prescaler) - 1)
+
+uint32_t nrf_pwm_set_frequency(uint32_t frequency_hz, uint32_t min_resolution, nrf_pwm_timing_t *achieved)
+{
+    uint32_t timer_hz, top, best_top = 0, best_prescaler = 0;
+    bool was_running = pwm_timer_running;
+    
+    if(frequency_hz == 0) return 0xFFFFFFFF;
+    // The slowest timer clock giving enough resolution draws the least current, a faster one only makes the
+    // frequency error (at most half a tick per period) smaller
+    for(int32_t prescaler = PWM_PRESCALER_MAX; prescaler >= 0 && best_top == 0; prescaler--)
+    {
+        timer_hz = PWM_TIMER_BASE_FREQUENCY >> prescaler;
+        top = (timer_hz + frequency_hz / 2) / frequency_hz;
+        // The update margin must leave room in the period, and the counter must never reach PWM_CC_PARKED
+        if(top < min_resolution || top >= PWM_CC_PARKED || top <= 2 * pwm_cc_margin_by_prescaler[prescaler]) continue;
+        best_top = top;
+        best_prescaler = prescaler;
+    }
+    if(best_top == 0) return 0xFFFFFFFF;
+    
+    // The prescaler can only be changed while the timers are stopped
+    nrf_pwm_set_enabled(false);
+    PWM_TIMER->PRESCALER = best_prescaler;
+    PWM_TIMER->CC[2] = pwm_max_value = pwm_next_max_value = best_top;
+    if(pwm_num_channels > 2)
+    {
+        PWM_TIMER2->PRESCALER = best_prescaler;
+        PWM_TIMER2->CC[2] = best_top;
+    }
+    pwm_cc_update_margin_ticks = pwm_cc_margin_by_prescaler[best_prescaler];
+    // Pending values are in the old range
+    for(uint32_t i = 0; i < pwm_num_channels; i++) pwm_modified[i] = false;
+    if(was_running) pwm_timers_start();
+    
+    if(achieved != 0)
+    {
+        timer_hz = PWM_TIMER_BASE_FREQUENCY >> best_prescaler;
+        achieved->frequency_hz = (timer_hz + best_top / 2) / best_top;
+        achieved->max_value = best_top;
+        achieved->prescaler = best_prescaler;
+    }
+    return 0;
+}
+
 void nrf_pwm_set_enabled(bool enabled)
 {
     if(enabled)
     {
-        PWM_TIMER->TASKS_START = 1;
-        if(pwm_num_channels > 2) PWM_TIMER2->TASKS_START = 1;
+        pwm_timers_start();
     }
     else
     {
+        // Restart from the beginning of a period, where the outputs are set up again
         PWM_TIMER->TASKS_STOP = 1;
-        if(pwm_num_channels > 2) PWM_TIMER2->TASKS_STOP = 1;
+        PWM_TIMER->TASKS_CLEAR = 1;
+        if(pwm_num_channels > 2)
+        {
+            PWM_TIMER2->TASKS_STOP = 1;
+            PWM_TIMER2->TASKS_CLEAR = 1;
+        }
+        pwm_timer_running = false;
         for(uint32_t i = 0; i < pwm_num_channels; i++)
         {
+            if(pwm_rtc_channel_mask & (1 << i)) continue;
             nrf_gpiote_unconfig(pwm_gpiote_channel[i]);
             nrf_gpio_pin_write(pwm_io_ch[i], 0); 
             pwm_running[i] = 0;
@@ -238,83 +437,260 @@ void nrf_pwm_set_enabled(bool enabled)
     }
 }
 
-void PWM_IRQHandler(void)
+void nrf_pwm_sys_event_handler(uint32_t sys_evt)
+{
+#if(USE_WITH_SOFTDEVICE == 1)
+    switch(sys_evt)
+    {
+        case NRF_EVT_RADIO_BLOCKED:
+        case NRF_EVT_RADIO_CANCELED:
+            // The modified values are still waiting, ask again
+            if(pwm_update_pending) sd_radio_request(&pwm_radio_request);
+            break;
+        default:
+            break;
+    }
+#endif
+}
+
+#if(PWM_SEQ_ENABLED == 1)
+uint32_t nrf_pwm_sequence_start(uint32_t channel_mask, const uint16_t *values, uint32_t step_count, uint32_t periods_per_step, bool loop)
+{
+    if(!pwm_seq_available || channel_mask == 0 || channel_mask >= (1 << pwm_num_channels)) return 0xFFFFFFFF;
+    if(step_count == 0 || periods_per_step == 0 || periods_per_step > 0xFFFF) return 0xFFFFFFFF;
+    
+    nrf_pwm_sequence_stop();
+    pwm_seq_num_values = 0;
+    for(uint32_t i = 0; i < pwm_num_channels; i++)
+    {
+        if(channel_mask & (1 << i)) pwm_seq_num_values++;
+    }
+    pwm_seq_channel_mask = channel_mask;
+    pwm_seq_values = values;
+    pwm_seq_step_count = step_count;
+    pwm_seq_loop = loop;
+    pwm_seq_index = 0;
+    pwm_seq_running = true;
+    PWM_SEQ_TIMER->CC[0] = periods_per_step;
+    
+    pwm_seq_step_load();
+    if(pwm_seq_running) PWM_SEQ_TIMER->TASKS_START = 1;
+    return 0;
+}
+
+void nrf_pwm_sequence_stop(void)
+{
+    if(!pwm_seq_available) return;
+    PWM_SEQ_TIMER->TASKS_STOP = 1;
+    PWM_SEQ_TIMER->TASKS_CLEAR = 1;
+    PWM_SEQ_TIMER->EVENTS_COMPARE[0] = 0;
+    pwm_seq_running = false;
+}
+
+bool nrf_pwm_sequence_is_running(void)
+{
+    return pwm_seq_running;
+}
+
+void PWM_SEQ_IRQHandler(void)
+{
+    PWM_SEQ_TIMER->EVENTS_COMPARE[0] = 0;
+    if(pwm_seq_running) pwm_seq_step_load();
+}
+#else
+uint32_t nrf_pwm_sequence_start(uint32_t channel_mask, const uint16_t *values, uint32_t step_count, uint32_t periods_per_step, bool loop)
+{
+    return 0xFFFFFFFF;
+}
+
+void nrf_pwm_sequence_stop(void)
+{
+}
+
+bool nrf_pwm_sequence_is_running(void)
+{
+    return false;
+}
+#endif
+
+static __INLINE uint32_t pwm_timer_capture(NRF_TIMER_Type *timer)
+{
+    timer->TASKS_CAPTURE[3] = 1;
+    return timer->CC[3];
+}
+
+// Applies the new value of a channel without waiting for the counter to move away from the compare points.
+// The compare register is parked while the old value is retired, so the old compare point can only match before
+// that and the new one only after it is written. The counter and the compare event then tell exactly how often
+// the output toggles in this period, and one precomputed toggle puts it right if the period would not end low.
+// Returns false, leaving the channel modified, if the counter is within the update margin of the period end,
+// where the clear could fall in the middle of the update
+static bool pwm_channel_apply(uint32_t i)
 {
-    static uint32_t i, new_capture, old_capture;
+    NRF_TIMER_Type *timer = (i < 2) ? PWM_TIMER : PWM_TIMER2;
+    uint32_t cc_index = i & 1;
+    uint32_t new_capture, old_capture, now, toggles;
+    
+    now = pwm_timer_capture(timer);
+    if(now + pwm_cc_update_margin_ticks >= pwm_max_value) return false;
+    // Cleared before the value is read, so a value set meanwhile stays modified and is applied by the next update
+    pwm_modified[i] = false;
+    new_capture = pwm_next_value[i];
+    if(new_capture == 0)
+    {
+        nrf_gpiote_unconfig(pwm_gpiote_channel[i]);
+        nrf_gpio_pin_write(pwm_io_ch[i], 0);
+        pwm_running[i] = 0;
+        return true;
+    }
+    if(new_capture >= pwm_max_value)
+    {
+        nrf_gpiote_unconfig(pwm_gpiote_channel[i]);
+        nrf_gpio_pin_write(pwm_io_ch[i], 1); 
+        pwm_running[i] = 0;
+        return true;
+    }
+    if(!pwm_running[i])
+    {
+        // Starts high, no compare point has toggled it yet
+        timer->CC[cc_index] = PWM_CC_PARKED;
+        nrf_gpiote_task_config(pwm_gpiote_channel[i], pwm_io_ch[i], NRF_GPIOTE_POLARITY_TOGGLE, NRF_GPIOTE_INITIAL_VALUE_HIGH);  
+        pwm_running[i] = 1;
+        toggles = 0;
+    }
+    else
+    {
+        // The output went high at the start of the period. The old value has toggled it if the counter was
+        // past it, or if it matched between the capture and the park
+        old_capture = timer->CC[cc_index];
+        timer->EVENTS_COMPARE[cc_index] = 0;
+        now = pwm_timer_capture(timer);
+        timer->CC[cc_index] = PWM_CC_PARKED;
+        toggles = (old_capture <= now || timer->EVENTS_COMPARE[cc_index]) ? 1 : 0;
+    }
+    // The new value toggles the output if it matched as it was written, or if the counter has not reached it yet
+    timer->EVENTS_COMPARE[cc_index] = 0;
+    timer->CC[cc_index] = new_capture;
+    now = pwm_timer_capture(timer);
+    if(timer->EVENTS_COMPARE[cc_index] || now < new_capture) toggles++;
+    // One toggle leaves the output low at the end of the period, where the period event sets it high again
+    if(toggles != 1) NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]] = 1;
+    return true;
+}
+
+// Applies the modified values. Without a SoftDevice this runs at the period boundary, on the COMPARE2 event that
+// clears the counter. With a SoftDevice it runs in a radio timeslot, which cannot be aligned to the period. Neither
+// waits for the counter: each channel update is a fixed sequence of register accesses, and a channel caught at the
+// end of the period is left for the next update. Both timers are in phase, so all the channels change in the same
+// period. Returns false if a channel was left. Define PWM_UPDATE_PROFILE_PIN to measure it on a GPIO
+static bool pwm_update_apply(void)
+{
+    bool is_done = true;
+    
+    // A transaction is open, its commit requests the update again
+    if(pwm_update_hold > 0) return true;
+#ifdef PWM_UPDATE_PROFILE_PIN
+    nrf_gpio_pin_set(PWM_UPDATE_PROFILE_PIN);
+#endif
     PWM_TIMER->CC[2] = pwm_max_value = pwm_next_max_value;
     if(pwm_num_channels > 2) PWM_TIMER2->CC[2] = pwm_max_value;
-    for(i = 0; i < pwm_num_channels; i++)
+    for(uint32_t i = 0; i < pwm_num_channels; i++)
     {
-        if(pwm_modified[i])
+        if(pwm_modified[i] && !(pwm_rtc_channel_mask & (1 << i)))
         {
-            pwm_modified[i] = false;
-            if(pwm_next_value[i] == 0)
-            {
-                nrf_gpiote_unconfig(pwm_gpiote_channel[i]);
-                nrf_gpio_pin_write(pwm_io_ch[i], 0);
-                pwm_running[i] = 0;
-            }
-            else if (pwm_next_value[i] >= pwm_max_value)
-            {
-                nrf_gpiote_unconfig(pwm_gpiote_channel[i]);
-                nrf_gpio_pin_write(pwm_io_ch[i], 1); 
-                pwm_running[i] = 0;
-            }
-            else
+            if(!pwm_channel_apply(i)) is_done = false;
+        }
+    }
+#ifdef PWM_UPDATE_PROFILE_PIN
+    nrf_gpio_pin_clear(PWM_UPDATE_PROFILE_PIN);
+#endif
+    return is_done;
+}
+
+#if(USE_WITH_SOFTDEVICE == 0)
+void PWM_IRQHandler(void)
+{
+    PWM_TIMER->EVENTS_COMPARE[2] = 0;
+    // Stays enabled while a channel is left, it is applied at the start of the next period
+    if(pwm_update_apply()) PWM_TIMER->INTENCLR = TIMER_INTENCLR_COMPARE2_Msk;
+}
+#endif
+
+#if(PWM_RTC_ENABLED == 1)
+// Applies the new value of an RTC channel. first is the counter read at the start of the interrupt, -1 for the
+// last tick of the previous period, whose compare event has already set the outputs high. The counter moves at most
+// one tick during the update, and a compare point written 0-1 ticks ahead of it may or may not match. A compare
+// point that could match either way leaves the channel modified for the next period instead of waiting it out;
+// otherwise the toggles still due in this period are known and one precomputed toggle corrects the output.
+// Returns false if the channel was left
+static bool pwm_rtc_channel_apply(uint32_t i, int32_t first)
+{
+    uint32_t value, toggles;
+    int32_t compare, old_compare;
+    
+    // Cleared before the value is read, as in pwm_channel_apply
+    pwm_modified[i] = false;
+    value = pwm_next_value[i];
+    if(value == 0)
+    {
+        nrf_gpiote_unconfig(pwm_gpiote_channel[i]);
+        nrf_gpio_pin_write(pwm_io_ch[i], 0);
+        pwm_running[i] = 0;
+        return true;
+    }
+    if(value >= pwm_max_value)
+    {
+        nrf_gpiote_unconfig(pwm_gpiote_channel[i]);
+        nrf_gpio_pin_write(pwm_io_ch[i], 1);
+        pwm_running[i] = 0;
+        return true;
+    }
+    // Scaled to RTC ticks. The compare point stays 3 ticks after the period start, so it is always ahead of a
+    // counter read at the period boundary, and before the period end
+    compare = (value * PWM_RTC_PERIOD_TICKS + pwm_max_value / 2) / pwm_max_value;
+    if(compare < 3) compare = 3;
+    if(compare > PWM_RTC_PERIOD_TICKS - 2) compare = PWM_RTC_PERIOD_TICKS - 2;
+    old_compare = pwm_running[i] ? (int32_t)PWM_RTC->CC[1 + i] : PWM_RTC_PERIOD_TICKS;
+    if((compare >= first && compare <= first + 2) || old_compare == first + 1)
+    {
+        pwm_modified[i] = true;
+        return false;
+    }
+    // The output went high at the start of the period, the old compare point has toggled it if the counter is past it
+    toggles = (old_compare <= first) ? 1 : 0;
+    if(compare > first) toggles++;
+    if(!pwm_running[i])
+    {
+        nrf_gpiote_task_config(pwm_gpiote_channel[i], pwm_io_ch[i], NRF_GPIOTE_POLARITY_TOGGLE, NRF_GPIOTE_INITIAL_VALUE_HIGH);
+        pwm_running[i] = 1;
+    }
+    PWM_RTC->CC[1 + i] = compare;
+    // One toggle leaves the output low at the end of the period, where the period event sets it high again
+    if(toggles != 1) NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]] = 1;
+    return true;
+}
+
+// Applies the modified values of the RTC channels at the RTC period boundary. This runs on the LFCLK alone, also
+// with a SoftDevice, as a radio timeslot would start the HFCLK
+void PWM_RTC_IRQHandler(void)
+{
+    uint32_t now = PWM_RTC->COUNTER;
+    int32_t first = (now >= PWM_RTC_PERIOD_TICKS - 1) ? -1 : (int32_t)now;
+    bool is_done = true;
+    
+    PWM_RTC->EVENTS_COMPARE[0] = 0;
+    // A transaction is open, its commit requests the update again
+    if(pwm_update_hold == 0)
+    {
+        for(uint32_t i = 0; i < pwm_num_channels; i++)
+        {
+            if(pwm_modified[i] && (pwm_rtc_channel_mask & (1 << i)))
             {
-                if(i < 2)
-                {
-                    new_capture = pwm_next_value[i];
-                    old_capture = PWM_TIMER->CC[i];
-                    if(!pwm_running[i])
-                    {
-                        nrf_gpiote_task_config(pwm_gpiote_channel[i], pwm_io_ch[i], NRF_GPIOTE_POLARITY_TOGGLE, NRF_GPIOTE_INITIAL_VALUE_HIGH);  
-                        pwm_running[i] = 1;
-                        PWM_TIMER->TASKS_CAPTURE[3] = 1;
-                        if(PWM_TIMER->CC[3] > new_capture) NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]] = 1;
-                        PWM_TIMER->CC[i] = new_capture;
-                    }
-                    else
-                    {
-                        while(1)
-                        {
-                            PWM_TIMER->TASKS_CAPTURE[3] = 1;
-                            if(safe_margins_present(PWM_TIMER_CURRENT, old_capture) && safe_margins_present(PWM_TIMER_CURRENT, new_capture)) break;
-                        }
-                        if((PWM_TIMER_CURRENT >= old_capture && PWM_TIMER_CURRENT < new_capture) || (PWM_TIMER_CURRENT < old_capture && PWM_TIMER_CURRENT >= new_capture))
-                        {
-                            NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]] = 1;
-                        }
-                        PWM_TIMER->CC[i] = new_capture;
-                    }
-                }
-                else
-                {
-                    new_capture = pwm_next_value[i];
-                    old_capture = PWM_TIMER2->CC[i-2];
-                    if(!pwm_running[i])
-                    {
-                        nrf_gpiote_task_config(pwm_gpiote_channel[i], pwm_io_ch[i], NRF_GPIOTE_POLARITY_TOGGLE, NRF_GPIOTE_INITIAL_VALUE_HIGH);  
-                        pwm_running[i] = 1;
-                        PWM_TIMER2->TASKS_CAPTURE[3] = 1;
-                        if(PWM_TIMER2->CC[3] > new_capture) NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]] = 1;
-                        PWM_TIMER2->CC[i-2] = new_capture;
-                    }
-                    else
-                    {
-                        while(1)
-                        {
-                            PWM_TIMER2->TASKS_CAPTURE[3] = 1;
-                            if(safe_margins_present(PWM_TIMER2_CURRENT, old_capture) && safe_margins_present(PWM_TIMER2_CURRENT, new_capture)) break;
-                        }
-                        if((PWM_TIMER2_CURRENT >= old_capture && PWM_TIMER2_CURRENT < new_capture) || (PWM_TIMER2_CURRENT < old_capture && PWM_TIMER2_CURRENT >= new_capture))
-                        {
-                            NRF_GPIOTE->TASKS_OUT[pwm_gpiote_channel[i]] = 1;
-                        }
-                        PWM_TIMER2->CC[i-2] = new_capture;
-                    }                    
-                }
+                if(!pwm_rtc_channel_apply(i, first)) is_done = false;
             }
         }
     }
+    // Stays enabled while a channel is left, it is applied at the start of the next period
+    if(is_done) PWM_RTC->INTENCLR = RTC_INTENCLR_COMPARE0_Msk;
 }
+#endif
@@ -7,8 +7,12 @@
 // The maximum number of channels supported by the library. Should NOT be changed! 
 #define PWM_MAX_CHANNELS        4
 
-// Set this to 1 if the application uses a SoftDevice, 0 otherwise
+// Set this to 1 if the application uses a SoftDevice, 0 otherwise. Can also be set from the compiler command line.
+// With a SoftDevice the updates are applied in a radio timeslot, and the application must forward its
+// system events to nrf_pwm_sys_event_handler
+#ifndef USE_WITH_SOFTDEVICE
 #define USE_WITH_SOFTDEVICE     0
+#endif
 
 // To change the timer used for the PWM library replace the three defines below
 #define PWM_TIMER               NRF_TIMER2
@@ -16,14 +20,65 @@
 #define PWM_IRQn                TIMER2_IRQn
 #define PWM_IRQ_PRIORITY        3
 
+// Define this to a GPIO number to drive it high while new values are applied, for measuring the update time
+//#define PWM_UPDATE_PROFILE_PIN  30
+
 // For 3-4 PWM channels a second timer is necessary
 #define PWM_TIMER2              NRF_TIMER1
 
+// Set this to 1 to build the waveform sequencer. It counts PWM periods on PWM_SEQ_TIMER for as long as the PWM runs,
+// so it takes that timer, its interrupt and ppi_channel[PWM_SEQ_PPI_INDEX] of the config, and is only available with
+// 1-2 channels. With 0 those stay free and nrf_pwm_sequence_start returns an error
+#ifndef PWM_SEQ_ENABLED
+#define PWM_SEQ_ENABLED         0
+#endif
+#define PWM_SEQ_TIMER           NRF_TIMER1
+#define PWM_SEQ_IRQHandler      TIMER1_IRQHandler
+#define PWM_SEQ_IRQn            TIMER1_IRQn
+#define PWM_SEQ_IRQ_PRIORITY    3
+#define PWM_SEQ_PPI_INDEX       4
+
+// Set this to 1 to drive the channels in rtc_channel_mask from an RTC on the 32kHz LFCLK instead of the PWM timer,
+// so an LED can glow with the HFCLK off. They keep their GPIOTE and PPI channels and the 0-max_value range of the
+// mode, scaled to PWM_RTC_PERIOD_TICKS steps, so values finer than 1/256 (PWM_MODE_LED_1000) are rounded, and the
+// shortest pulse is 3 ticks. The RTC is cleared every period through ppi_channel[PWM_RTC_PPI_INDEX], so it cannot be
+// shared with app_timer or the SoftDevice: with the S110 and app_timer both RTCs are taken and the backend cannot
+// be used. The LFCLK must be running. Only with 1-2 channels
+#ifndef PWM_RTC_ENABLED
+#define PWM_RTC_ENABLED         0
+#endif
+// The RTC used by the backend. The SoftDevice owns RTC0, so with USE_WITH_SOFTDEVICE only RTC1 is allowed, and then
+// the application must not use app_timer, which also runs on RTC1 and defines its interrupt handler
+#ifndef PWM_RTC_INSTANCE
+#define PWM_RTC_INSTANCE        1
+#endif
+#if(PWM_RTC_INSTANCE == 0)
+#define PWM_RTC                 NRF_RTC0
+#define PWM_RTC_IRQHandler      RTC0_IRQHandler
+#define PWM_RTC_IRQn            RTC0_IRQn
+#elif(PWM_RTC_INSTANCE == 1)
+#define PWM_RTC                 NRF_RTC1
+#define PWM_RTC_IRQHandler      RTC1_IRQHandler
+#define PWM_RTC_IRQn            RTC1_IRQn
+#else
+#error "PWM_RTC_INSTANCE must be 0 or 1, the nRF51 has no other RTC"
+#endif
+#define PWM_RTC_IRQ_PRIORITY    3
+#define PWM_RTC_PPI_INDEX       5
+#define PWM_RTC_PERIOD_TICKS    256     // 128Hz PWM frequency
+
+// PPI channels taken with PWM_DEFAULT_CONFIG, which maps ppi_channel[i] to PPI channel i: two per PWM channel, and
+// the sequencer and RTC backend indexes when they are built in. Lets an application check its own channels at compile time
+#define PWM_DEFAULT_PPI_MASK(num_channels)  (((1UL << (2 * (num_channels))) - 1) |                         \
+                                             ((PWM_SEQ_ENABLED == 1) ? (1UL << PWM_SEQ_PPI_INDEX) : 0) |   \
+                                             ((PWM_RTC_ENABLED == 1) ? (1UL << PWM_RTC_PPI_INDEX) : 0))
+
 #define PWM_DEFAULT_CONFIG  {.num_channels   = 2,                \
                              .gpio_num       = {8,9,11,12},         \
                              .ppi_channel    = {0,1,2,3,4,5,6,7},    \
                              .gpiote_channel = {2,3,0,1},          \
-                             .mode           = PWM_MODE_LED_100};
+                             .mode           = PWM_MODE_LED_100,   \
+                             .rtc_channel_mask = 0};
 
 typedef enum
 {
@@ -37,6 +92,18 @@ typedef enum
     PWM_MODE_BUZZER_255  // 8-bit resolution, 62.5kHz PWM frequency, 16MHz timer frequency (prescaler 0)
 } nrf_pwm_mode_t;
 
+// Maximum value of each mode, usable in constant expressions
+#define PWM_MODE_MAX_VALUE(mode)    (((mode) == PWM_MODE_LED_1000) ? 1000 : \
+                                     (((mode) == PWM_MODE_LED_100) || ((mode) == PWM_MODE_MTR_100)) ? 100 : 255)
+
+// Timing achieved by nrf_pwm_set_frequency
+typedef struct
+{
+    uint32_t        frequency_hz;   // PWM frequency, rounded to the nearest Hz
+    uint32_t        max_value;      // Value giving a 100% duty cycle, the resolution is max_value steps
+    uint8_t         prescaler;      // Timer prescaler, the timer counts at 16MHz >> prescaler
+} nrf_pwm_timing_t;
+
 typedef struct
 {
     uint8_t         num_channels;
@@ -44,6 +111,7 @@ typedef struct
     uint8_t         ppi_channel[8];
     uint8_t         gpiote_channel[4];
     uint8_t         mode;
+    uint8_t         rtc_channel_mask;   // Channels driven by the RTC backend, needs PWM_RTC_ENABLED
 } nrf_pwm_config_t; 
 
 uint32_t nrf_pwm_init(nrf_pwm_config_t *config);
@@ -52,8 +120,46 @@ void nrf_pwm_set_value(uint32_t pwm_channel, uint32_t pwm_value);
 
 void nrf_pwm_set_values(uint32_t pwm_channel_num, uint32_t *pwm_values);
 
+// Updates several channels at once: values staged between begin and commit are applied together, in the same
+// PWM period on both timers, so no intermediate combination is ever output. Transactions may be nested, the
+// outermost commit applies them. nrf_pwm_set_value calls made meanwhile are held back too
+void nrf_pwm_update_begin(void);
+
+void nrf_pwm_update_stage(uint32_t pwm_channel, uint32_t pwm_value);
+
+void nrf_pwm_update_commit(void);
+
+// A compare register is set to this while a channel is updated. It is never reached, so periods are at most 0xFFFE ticks
+#define PWM_CC_PARKED           0xFFFF
+
+// Changes the period in timer ticks from the next update on, keeping the timer clock of the mode. Up to 0xFFFE
 void nrf_pwm_set_max_value(uint32_t max_value);
 
+// Sets any PWM frequency with at least min_resolution steps, instead of the fixed pair of the mode.
+// The slowest, most power efficient timer clock giving enough resolution is used, the period is rounded to the
+// nearest tick of it. The update margin follows the prescaler.
+// The outputs are switched off, set the channel values again in the new range of 0-max_value.
+// Returns 0 and fills in achieved (may be NULL), or 0xFFFFFFFF if no prescaler gives the resolution at this frequency.
+uint32_t nrf_pwm_set_frequency(uint32_t frequency_hz, uint32_t min_resolution, nrf_pwm_timing_t *achieved);
+
+// Starts or stops the PWM timers, RTC channels keep running
 void nrf_pwm_set_enabled(bool enabled);
 
+// Requests a new timeslot when the SoftDevice has blocked or canceled the pending one. Only needed with USE_WITH_SOFTDEVICE
+void nrf_pwm_sys_event_handler(uint32_t sys_evt);
+
+// Plays a waveform on the channels in channel_mask without CPU involvement between steps.
+// values holds step_count steps, each with one value per channel in channel_mask, lowest channel first.
+// The PWM timer counts its periods on PWM_SEQ_TIMER through PPI, and the lowest priority sequencer
+// interrupt only loads the next step every periods_per_step periods (1-65535). The first step is
+// loaded immediately. values must stay valid until the sequence ends or is stopped.
+// Returns 0 on success, 0xFFFFFFFF if a parameter is invalid, more than 2 channels are configured or PWM_SEQ_ENABLED is 0.
+uint32_t nrf_pwm_sequence_start(uint32_t channel_mask, const uint16_t *values, uint32_t step_count, uint32_t periods_per_step, bool loop);
+
+// Stops the sequence, the outputs keep the last loaded step
+void nrf_pwm_sequence_stop(void);
+
+// Returns true until the last step of a non-looping sequence has been loaded
+bool nrf_pwm_sequence_is_running(void);
+
 #endif
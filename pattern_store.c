@@ -0,0 +1,224 @@
+#include "pattern_store.h"
+#include <stddef.h>
+#include <string.h>
+#include "nrf_error.h"
+#include "pstorage.h"
+
+static pstorage_handle_t                m_base_handle;                              /**< Handle of the first slot. */
+static uint32_t                         m_base_address;                             /**< Flash address of the first slot. */
+static uint16_t                         m_valid_mask;                               /**< Bit mask of the slots holding a valid pattern. */
+static volatile bool                    m_is_busy;                                  /**< A commit is being written. */
+static uint8_t                          m_busy_id;                                  /**< ID of the commit being written. */
+static pattern_store_evt_handler_t      m_evt_handler;                              /**< Commit completion handler. */
+static union
+{
+    pattern_slot_t           slot;
+    uint32_t                 words[sizeof(pattern_slot_t) / sizeof(uint32_t)];
+} m_staging_buffer;                                                                 /**< Pattern being uploaded, also the source of the flash write, which must be word aligned. */
+static pattern_slot_t * const           m_p_staging = &m_staging_buffer.slot;       /**< Staged slot. */
+static uint8_t                          m_staging_id = PATTERN_SLOT_COUNT;          /**< ID of the staged keyframes, PATTERN_SLOT_COUNT if none. */
+static uint16_t                         m_staging_mask;                             /**< Bit mask of the staged keyframes. */
+
+
+/**@brief   Function for computing the byte sum of a slot, zero for a consistent slot. */
+static uint8_t slot_sum_get(const pattern_slot_t * p_slot)
+{
+    const uint8_t * p_byte = (const uint8_t *)p_slot;
+    uint16_t        length = offsetof(pattern_slot_t, keyframes) + p_slot->header.count * sizeof(anim_keyframe_t);
+    uint8_t         sum    = 0;
+    uint16_t        i;
+
+    for (i = 0; i < length; i++)
+    {
+        sum += p_byte[i];
+    }
+    return sum;
+}
+
+
+/**@brief   Function for checking a slot header and keyframes. */
+static bool slot_is_valid(const pattern_slot_t * p_slot)
+{
+    uint8_t i;
+
+    if ((p_slot->header.magic != PATTERN_MAGIC)           ||
+        (p_slot->header.target >= PATTERN_TARGET_COUNT)   ||
+        (p_slot->header.count == 0)                       ||
+        (p_slot->header.count > PATTERN_KEYFRAMES_MAX))
+    {
+        return false;
+    }
+    for (i = 0; i < p_slot->header.count; i++)
+    {
+        if (p_slot->keyframes[i].interp >= ANIM_INTERP_COUNT)
+        {
+            return false;
+        }
+    }
+    return (slot_sum_get(p_slot) == 0);
+}
+
+
+/**@brief   Function for rebuilding the valid slot mask from flash. */
+static void valid_mask_update(void)
+{
+    uint8_t id;
+
+    m_valid_mask = 0;
+    for (id = 0; id < PATTERN_SLOT_COUNT; id++)
+    {
+        if (slot_is_valid((const pattern_slot_t *)(m_base_address + id * sizeof(pattern_slot_t))))
+        {
+            m_valid_mask |= (1 << id);
+        }
+    }
+}
+
+
+/**@brief   Function for handling pstorage events. */
+static void pstorage_cb(pstorage_handle_t * p_handle,
+                        uint8_t             op_code,
+                        uint32_t            result,
+                        uint8_t           * p_data,
+                        uint32_t            data_len)
+{
+    if ((op_code != PSTORAGE_UPDATE_OP_CODE) || !m_is_busy)
+    {
+        return;
+    }
+    // The whole page has been rewritten, check every slot rather than trusting the previous mask.
+    valid_mask_update();
+    m_is_busy = false;
+    m_staging_id = PATTERN_SLOT_COUNT;
+    if (m_evt_handler != NULL)
+    {
+        m_evt_handler(m_busy_id, result);
+    }
+}
+
+
+uint32_t pattern_store_init(pattern_store_evt_handler_t evt_handler)
+{
+    pstorage_module_param_t param;
+    uint32_t                err_code;
+
+    m_evt_handler = evt_handler;
+
+    param.block_size  = sizeof(pattern_slot_t);
+    param.block_count = PATTERN_SLOT_COUNT;
+    param.cb          = pstorage_cb;
+    err_code = pstorage_register(&param, &m_base_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    m_base_address = m_base_handle.block_id;
+    valid_mask_update();
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pattern_store_stage(uint8_t id, uint8_t first, const uint8_t * p_data, uint8_t count)
+{
+    uint8_t i;
+
+    if ((id >= PATTERN_SLOT_COUNT) || (first >= PATTERN_KEYFRAMES_MAX) || (count > PATTERN_KEYFRAMES_MAX - first))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_is_busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (id != m_staging_id)
+    {
+        m_staging_id   = id;
+        m_staging_mask = 0;
+    }
+
+    for (i = 0; i < count; i++, p_data += sizeof(anim_keyframe_t))
+    {
+        m_p_staging->keyframes[first + i].duration_ms = (uint16_t)(p_data[0] | (p_data[1] << 8));
+        m_p_staging->keyframes[first + i].value       = p_data[2];
+        m_p_staging->keyframes[first + i].interp      = p_data[3];
+        m_staging_mask |= (1 << (first + i));
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t pattern_store_commit(uint8_t id, uint8_t target, uint8_t count, const motor_profile_config_t * p_profile)
+{
+    pstorage_handle_t   handle;
+    uint16_t            length;
+    uint32_t            err_code;
+
+    if ((id >= PATTERN_SLOT_COUNT) || (count > PATTERN_KEYFRAMES_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_is_busy)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    if (count == 0)
+    {
+        // An erased slot only needs a header that does not validate.
+        memset(&m_p_staging->header, 0, sizeof(m_p_staging->header));
+    }
+    else
+    {
+        if ((id != m_staging_id) || ((m_staging_mask & ((1 << count) - 1)) != ((1 << count) - 1)))
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+        m_p_staging->header.magic    = PATTERN_MAGIC;
+        m_p_staging->header.target   = target;
+        m_p_staging->header.count    = count;
+        m_p_staging->profile         = *p_profile;
+        m_p_staging->header.checksum = 0;
+        m_p_staging->header.checksum = (uint8_t)(0 - slot_sum_get(m_p_staging));
+        if (!slot_is_valid(m_p_staging))
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    err_code = pstorage_block_identifier_get(&m_base_handle, id, &handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    length = (count == 0) ? sizeof(pattern_header_t) : (offsetof(pattern_slot_t, keyframes) + count * sizeof(anim_keyframe_t));
+
+    // Readers in interrupt context must see the store busy before the flash can change.
+    m_is_busy = true;
+    err_code  = pstorage_update(&handle, (uint8_t *)m_p_staging, length, 0);
+    if (err_code != NRF_SUCCESS)
+    {
+        m_is_busy = false;
+        return err_code;
+    }
+
+    m_busy_id    = id;
+    m_staging_id = id;
+    return NRF_SUCCESS;
+}
+
+
+const pattern_slot_t * pattern_store_get(uint8_t id)
+{
+    if ((id >= PATTERN_SLOT_COUNT) || m_is_busy || !(m_valid_mask & (1 << id)))
+    {
+        return NULL;
+    }
+    return (const pattern_slot_t *)(m_base_address + id * sizeof(pattern_slot_t));
+}
+
+
+bool pattern_store_is_busy(void)
+{
+    return m_is_busy;
+}
@@ -0,0 +1,119 @@
+/**@file
+ *
+ * @defgroup pattern_store Actuator pattern storage
+ * @{
+ * @brief    Keeps keyframe patterns uploaded over BLE in flash, indexed by ID.
+ *
+ * @details  Patterns are kept in PATTERN_SLOT_COUNT fixed-size pstorage blocks, the ID is the block
+ *           index, so a lookup is an address computation and a bit test. The keyframes are played
+ *           directly from flash. A pattern is uploaded into a RAM staging buffer in chunks, then
+ *           validated and written as a whole on commit.
+ *
+ *           Writing a slot goes through the pstorage swap page and rewrites the whole page, so no
+ *           pattern can be looked up until the write has completed. Callers must stop playing stored
+ *           patterns before committing.
+ *
+ * @note     pstorage_init must have been called and system events must be forwarded to
+ *           pstorage_sys_event_handler.
+ */
+
+#ifndef PATTERN_STORE_H__
+#define PATTERN_STORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "anim_player.h"
+#include "motor_profile.h"
+
+#define PATTERN_SLOT_COUNT              16                           /**< Number of pattern IDs, the slots fill one 1 kB flash page. */
+#define PATTERN_KEYFRAMES_MAX           14                           /**< Maximum number of keyframes in a pattern. */
+#define PATTERN_MAGIC                   0xA6                         /**< Marks a written slot of the current layout. */
+
+/**@brief   Actuator a pattern is meant for. */
+typedef enum
+{
+    PATTERN_TARGET_LED,
+    PATTERN_TARGET_MOTOR,
+    PATTERN_TARGET_COUNT
+} pattern_target_t;
+
+/**@brief   Slot header, 4 bytes. */
+typedef struct
+{
+    uint8_t                  magic;                   /**< PATTERN_MAGIC for a written slot. */
+    uint8_t                  target;                  /**< @ref pattern_target_t. */
+    uint8_t                  count;                   /**< Number of keyframes. */
+    uint8_t                  checksum;                /**< Makes the byte sum of the header, profile and keyframes zero. */
+} pattern_header_t;
+
+/**@brief   Layout of a slot in flash, 64 bytes. */
+typedef struct
+{
+    pattern_header_t         header;
+    motor_profile_config_t   profile;                 /**< Drive profile, used when the target is the motor. */
+    anim_keyframe_t          keyframes[PATTERN_KEYFRAMES_MAX];
+} pattern_slot_t;
+
+/**@brief   Pattern store event handler type, called when a commit has been written.
+ *
+ * @param[in]   id          ID of the committed pattern.
+ * @param[in]   result      NRF_SUCCESS, or the pstorage error.
+ */
+typedef void (*pattern_store_evt_handler_t)(uint8_t id, uint32_t result);
+
+/**@brief       Function for registering the pattern slots with pstorage and finding the valid ones.
+ *
+ * @param[in]   evt_handler Called when a commit has been written, may be NULL.
+ *
+ * @return      NRF_SUCCESS, or the pstorage error.
+ */
+uint32_t pattern_store_init(pattern_store_evt_handler_t evt_handler);
+
+/**@brief       Function for staging keyframes of a pattern being uploaded.
+ *
+ * @details     Staging keyframes for another ID than the previous call discards the staged ones.
+ *
+ * @param[in]   id          Pattern ID.
+ * @param[in]   first       Index of the first keyframe in p_data.
+ * @param[in]   p_data      Keyframes, each a little-endian u16 duration (ms), a value and an
+ *                          @ref anim_interp_t.
+ * @param[in]   count       Number of keyframes in p_data.
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM for an ID or index out of range, or
+ *              NRF_ERROR_BUSY while a commit is being written.
+ */
+uint32_t pattern_store_stage(uint8_t id, uint8_t first, const uint8_t * p_data, uint8_t count);
+
+/**@brief       Function for validating the staged pattern and writing it to its slot.
+ *
+ * @details     A count of 0 erases the slot. The write completes asynchronously, the event handler
+ *              is called when it has.
+ *
+ * @param[in]   id          Pattern ID, must match the staged keyframes unless count is 0.
+ * @param[in]   target      @ref pattern_target_t.
+ * @param[in]   count       Number of keyframes.
+ * @param[in]   p_profile   Drive profile stored with the pattern.
+ *
+ * @return      NRF_SUCCESS if the write was started, NRF_ERROR_INVALID_PARAM if the pattern is not
+ *              valid or not completely staged, NRF_ERROR_BUSY while another commit is being
+ *              written, or the pstorage error.
+ */
+uint32_t pattern_store_commit(uint8_t id, uint8_t target, uint8_t count, const motor_profile_config_t * p_profile);
+
+/**@brief       Function for looking up a pattern.
+ *
+ * @param[in]   id          Pattern ID.
+ *
+ * @return      The slot in flash, NULL if the ID is empty or a commit is being written.
+ */
+const pattern_slot_t * pattern_store_get(uint8_t id);
+
+/**@brief       Function for checking whether a commit is being written.
+ *
+ * @return      true from a successful @ref pattern_store_commit until its event.
+ */
+bool pattern_store_is_busy(void);
+
+#endif // PATTERN_STORE_H__
+
+/** @} */
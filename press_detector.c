@@ -0,0 +1,97 @@
+#include "press_detector.h"
+#include <string.h>
+
+
+static uint32_t ticks_diff(uint32_t later, uint32_t earlier)
+{
+    return (later - earlier) & PRESS_DETECTOR_TICK_MASK;
+}
+
+
+void press_detector_init(press_detector_t * p_det, const press_detector_config_t * p_config)
+{
+    memset(p_det, 0, sizeof(press_detector_t));
+    p_det->config = *p_config;
+    p_det->state  = PRESS_STATE_RELEASED;
+}
+
+
+bool press_detector_config_set(press_detector_t * p_det, const press_detector_config_t * p_config)
+{
+    if (p_config->release_threshold < p_config->press_threshold)
+    {
+        return false;
+    }
+    p_det->config = *p_config;
+    return true;
+}
+
+
+bool press_detector_sample(press_detector_t * p_det, uint16_t value, uint32_t ticks)
+{
+    switch (p_det->state)
+    {
+        case PRESS_STATE_RELEASED:
+            if (value >= p_det->config.press_threshold)
+            {
+                return false;
+            }
+            p_det->state      = PRESS_STATE_PENDING;
+            p_det->edge_ticks = ticks;
+            // A zero dwell time reports the press on its first sample.
+            /* fall through */
+
+        case PRESS_STATE_PENDING:
+            if (value >= p_det->config.release_threshold)
+            {
+                p_det->state = PRESS_STATE_RELEASED;
+                p_det->stats.rejected_bounces++;
+                return false;
+            }
+            if (ticks_diff(ticks, p_det->edge_ticks) < p_det->config.dwell_ticks)
+            {
+                return false;
+            }
+            p_det->state = PRESS_STATE_PRESSED;
+            if (p_det->has_pressed &&
+                (ticks_diff(ticks, p_det->last_press_ticks) < p_det->config.refractory_ticks))
+            {
+                p_det->stats.rejected_bounces++;
+                return false;
+            }
+            p_det->has_pressed      = true;
+            p_det->last_press_ticks = ticks;
+            p_det->stats.detections++;
+            return true;
+
+        case PRESS_STATE_PRESSED:
+            if (value >= p_det->config.release_threshold)
+            {
+                p_det->state = PRESS_STATE_RELEASED;
+            }
+            return false;
+
+        default:
+            p_det->state = PRESS_STATE_RELEASED;
+            return false;
+    }
+}
+
+
+void press_detector_latency_record(press_detector_t * p_det, uint32_t sample_ticks, uint32_t notify_ticks)
+{
+    uint32_t latency = ticks_diff(notify_ticks, sample_ticks);
+
+    p_det->stats.latency_count++;
+    p_det->stats.latency_sum_ticks += latency;
+    if (latency > p_det->stats.latency_max_ticks)
+    {
+        p_det->stats.latency_max_ticks = latency;
+    }
+}
+
+
+void press_detector_stats_reset(press_detector_t * p_det)
+{
+    memset(&p_det->stats, 0, sizeof(press_detector_stats_t));
+}
@@ -0,0 +1,105 @@
+/**@file
+ *
+ * @defgroup press_detector Droplet press detector
+ * @{
+ * @brief    Press detection state machine with hysteresis, debounce and refractory time.
+ *
+ * @details  A press is entered when the filtered signal falls below press_threshold and left when
+ *           it rises to release_threshold or above. The signal must stay pressed for dwell_ticks
+ *           before a press is reported, and presses that complete within refractory_ticks of the
+ *           last reported one are counted as bounces instead of being reported again.
+ *
+ *           All times are RTC ticks. Tick differences are taken modulo the 24-bit RTC counter.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef PRESS_DETECTOR_H__
+#define PRESS_DETECTOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PRESS_DETECTOR_TICK_MASK        0x00FFFFFF                   /**< Width of the RTC counter the timestamps come from. */
+
+/**@brief   Press detector tuning parameters. */
+typedef struct
+{
+    uint16_t                 press_threshold;         /**< Filtered value below which the sensor is considered pressed. */
+    uint16_t                 release_threshold;       /**< Filtered value at or above which the sensor is considered released. Must not be below press_threshold. */
+    uint32_t                 dwell_ticks;             /**< Time the signal must stay pressed before the press is reported. */
+    uint32_t                 refractory_ticks;        /**< Minimum time between two reported presses. */
+} press_detector_config_t;
+
+/**@brief   Press detector statistics. */
+typedef struct
+{
+    uint32_t                 detections;              /**< Number of reported presses. */
+    uint32_t                 rejected_bounces;        /**< Presses released before the dwell time or completed within the refractory time. */
+    uint32_t                 latency_count;           /**< Number of latency measurements in latency_sum_ticks. */
+    uint32_t                 latency_sum_ticks;       /**< Sum of sample-to-notification latencies. */
+    uint32_t                 latency_max_ticks;       /**< Largest sample-to-notification latency. */
+} press_detector_stats_t;
+
+/**@brief   Press detector states. */
+typedef enum
+{
+    PRESS_STATE_RELEASED,                             /**< Signal above the press threshold. */
+    PRESS_STATE_PENDING,                              /**< Signal pressed, waiting for the dwell time. */
+    PRESS_STATE_PRESSED                               /**< Press handled, waiting for the release threshold. */
+} press_state_t;
+
+/**@brief   Press detector instance. */
+typedef struct
+{
+    press_detector_config_t  config;                  /**< Tuning parameters. */
+    press_detector_stats_t   stats;                   /**< Statistics, cleared by @ref press_detector_stats_reset. */
+    press_state_t            state;                   /**< Current state. */
+    uint32_t                 edge_ticks;              /**< Timestamp of the sample that entered PRESS_STATE_PENDING. */
+    uint32_t                 last_press_ticks;        /**< Timestamp of the last reported press. */
+    bool                     has_pressed;             /**< true once a press has been reported, so last_press_ticks is valid. */
+} press_detector_t;
+
+/**@brief       Function for initializing a press detector in the released state.
+ *
+ * @param[out]  p_det       Detector to initialize.
+ * @param[in]   p_config    Tuning parameters.
+ */
+void press_detector_init(press_detector_t * p_det, const press_detector_config_t * p_config);
+
+/**@brief       Function for changing the tuning parameters of a running detector.
+ *
+ * @param[in]   p_det       Detector.
+ * @param[in]   p_config    New tuning parameters.
+ *
+ * @return      false if release_threshold is below press_threshold and the parameters were rejected.
+ */
+bool press_detector_config_set(press_detector_t * p_det, const press_detector_config_t * p_config);
+
+/**@brief       Function for feeding a filtered sample to the detector.
+ *
+ * @param[in]   p_det       Detector.
+ * @param[in]   value       Filtered ADC sample.
+ * @param[in]   ticks       RTC timestamp of the sample.
+ *
+ * @return      true if a press is to be reported for this sample.
+ */
+bool press_detector_sample(press_detector_t * p_det, uint16_t value, uint32_t ticks);
+
+/**@brief       Function for recording the latency between a detecting sample and its notification.
+ *
+ * @param[in]   p_det         Detector.
+ * @param[in]   sample_ticks  Timestamp of the sample that caused the press to be reported.
+ * @param[in]   notify_ticks  Timestamp at which the notification was queued.
+ */
+void press_detector_latency_record(press_detector_t * p_det, uint32_t sample_ticks, uint32_t notify_ticks);
+
+/**@brief       Function for clearing the detector statistics.
+ *
+ * @param[in]   p_det       Detector.
+ */
+void press_detector_stats_reset(press_detector_t * p_det);
+
+#endif // PRESS_DETECTOR_H__
+
+/** @} */
@@ -0,0 +1,18 @@
+#include "rx_value.h"
+
+
+uint32_t rx_value_parse(const uint8_t * p_data, uint16_t length)
+{
+    uint32_t    value = 0;
+    uint16_t    i;
+
+    for (i = 0; (i < length) && (p_data[i] >= '0') && (p_data[i] <= '9'); i++)
+    {
+        value = value * 10 + (p_data[i] - '0');
+        if (value > RX_VALUE_MAX)
+        {
+            value = RX_VALUE_MAX;
+        }
+    }
+    return value;
+}
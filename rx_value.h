@@ -0,0 +1,37 @@
+/**@file
+ *
+ * @defgroup rx_value Received value parsing
+ * @{
+ * @brief    Parses the decimal values written over the Nordic UART Service into fill level units.
+ *
+ * @details  A value is written as ASCII digits in tenths of a fill level unit, without a null
+ *           terminator. It is parsed without atoi and scaled without a division or floating point,
+ *           as the Cortex-M0 has neither a divider nor an FPU.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef RX_VALUE_H__
+#define RX_VALUE_H__
+
+#include <stdint.h>
+#include "fill_level.h"
+
+#define RX_VALUE_MAX                    0xFFFF                       /**< Largest parsed value, larger ones saturate. */
+#define RX_VALUE_TO_FILL(VAL)           (((uint32_t)(VAL) * 6554) >> (16 - FILL_LEVEL_FRAC_BITS)) /**< Converts a received value to fill level units, a tenth in fixed point (6554 / 65536 ~ 1 / 10). */
+
+/**@brief       Function for parsing the leading decimal digits of a received value.
+ *
+ * @details     Unlike atoi, this stops at the end of the data, which is not null terminated, and
+ *              saturates at RX_VALUE_MAX instead of overflowing.
+ *
+ * @param[in]   p_data      Received data.
+ * @param[in]   length      Length of the data.
+ *
+ * @return      Parsed value, 0 if the data does not start with a digit.
+ */
+uint32_t rx_value_parse(const uint8_t * p_data, uint16_t length);
+
+#endif // RX_VALUE_H__
+
+/** @} */
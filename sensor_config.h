@@ -0,0 +1,24 @@
+/**@file
+ *
+ * @brief    Default tuning of the droplet sensor chain.
+ *
+ * @details  Shared by main.c and the host trace replay (test/replay.c), so a replay always
+ *           measures the defaults the firmware is built with. The press detection values are
+ *           only defaults, the peer can change them at run time.
+ */
+
+#ifndef SENSOR_CONFIG_H__
+#define SENSOR_CONFIG_H__
+
+#define ADC_OVERSAMPLE_LOG2             2                                           /**< Number of sensor conversions per sampling tick as a power of two (2: 4x), averaged into one sample. */
+#define ADC_SCHED_NEAR_BAND             40                                          /**< Filtered samples closer than this to the threshold keep the fast rate. */
+#define ADC_SCHED_CHANGE_DELTA          8                                           /**< Sample-to-sample change that switches back to the fast rate. */
+#define ADC_SCHED_QUIET_SAMPLES         40                                          /**< Quiet samples before backing off from the fast rate (200ms at 5ms). */
+#define SENSOR_PRESS_DEPTH              60                                          /**< Default distance below the baseline, in 10-bit ADC units, at which a press starts. */
+#define SENSOR_RELEASE_DEPTH            30                                          /**< Default distance below the baseline, in 10-bit ADC units, at which a press ends. */
+#define SENSOR_BASELINE_SHIFT           8                                           /**< Default baseline averaging shift, the time constant is about 2^shift samples. */
+#define SENSOR_DWELL_MS                 10                                          /**< Default time the sensor must stay pressed before a press is reported. */
+#define SENSOR_REFRACTORY_MS            200                                         /**< Default minimum time between two reported presses. */
+#define SENSOR_MAX_PRESS_MS             5000                                        /**< Press duration after which the baseline is taken to have stepped down and restarts from the current sample. */
+
+#endif // SENSOR_CONFIG_H__
@@ -0,0 +1,20 @@
+#include "sensor_event.h"
+
+
+static void uint24_encode(uint32_t value, uint8_t * p_buffer)
+{
+    p_buffer[0] = (uint8_t)(value);
+    p_buffer[1] = (uint8_t)(value >> 8);
+    p_buffer[2] = (uint8_t)(value >> 16);
+}
+
+
+uint16_t sensor_event_encode(const sensor_event_t * p_event, uint8_t * p_buffer)
+{
+    p_buffer[0] = p_event->type;
+    p_buffer[1] = (uint8_t)(p_event->sequence);
+    p_buffer[2] = (uint8_t)(p_event->sequence >> 8);
+    uint24_encode(p_event->sample_ticks, &p_buffer[3]);
+    uint24_encode(p_event->queued_ticks, &p_buffer[6]);
+    return SENSOR_EVENT_LEN;
+}
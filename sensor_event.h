@@ -0,0 +1,48 @@
+/**@file
+ *
+ * @defgroup sensor_event Sensor event record
+ * @{
+ * @brief    Binary record notified to the peer for every detected sensor event.
+ *
+ * @details  Layout, little-endian, SENSOR_EVENT_LEN bytes:
+ *           - type (u8), e.g. SENSOR_EVENT_TYPE_PRESS
+ *           - sequence number (u16), incremented for every detected event, including events that
+ *             could not be notified, so the peer can count lost events from gaps
+ *           - RTC1 tick of the sample that caused the event (u24)
+ *           - RTC1 tick at which the notification was queued (u24)
+ *
+ *           The peer can split sensor-to-app latency into detection (queued - sample) and
+ *           transport (arrival - queued) delays.
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef SENSOR_EVENT_H__
+#define SENSOR_EVENT_H__
+
+#include <stdint.h>
+
+#define SENSOR_EVENT_LEN                9                            /**< Length of an encoded event record. */
+#define SENSOR_EVENT_TYPE_PRESS         'P'                          /**< Droplet press detected. */
+
+/**@brief   Sensor event. */
+typedef struct
+{
+    uint8_t                  type;                    /**< Event type. */
+    uint16_t                 sequence;                /**< Event sequence number. */
+    uint32_t                 sample_ticks;            /**< RTC1 tick of the sample that caused the event. */
+    uint32_t                 queued_ticks;            /**< RTC1 tick at which the notification was queued. */
+} sensor_event_t;
+
+/**@brief       Function for encoding an event record.
+ *
+ * @param[in]   p_event     Event to encode.
+ * @param[out]  p_buffer    Buffer of at least SENSOR_EVENT_LEN bytes.
+ *
+ * @return      Length of the encoded record.
+ */
+uint16_t sensor_event_encode(const sensor_event_t * p_event, uint8_t * p_buffer);
+
+#endif // SENSOR_EVENT_H__
+
+/** @} */
@@ -0,0 +1,75 @@
+#include "sensor_pipeline.h"
+
+
+static uint16_t level_below(uint16_t level, uint16_t depth)
+{
+    return (level > depth) ? (level - depth) : 0;
+}
+
+
+void sensor_pipeline_init(sensor_pipeline_t * p_pipeline, const sensor_pipeline_config_t * p_config)
+{
+    adc_scheduler_init(&p_pipeline->scheduler, &p_config->scheduler);
+    press_detector_init(&p_pipeline->detector, &p_config->detector);
+    baseline_tracker_init(&p_pipeline->baseline, p_config->baseline_shift);
+    p_pipeline->press_depth   = p_config->press_depth;
+    p_pipeline->release_depth = p_config->release_depth;
+    p_pipeline->max_press_ticks = p_config->max_press_ticks;
+    p_pipeline->reseed_count    = 0;
+    p_pipeline->value        = 0;
+    p_pipeline->sample_count = 0;
+}
+
+
+bool sensor_pipeline_depth_set(sensor_pipeline_t * p_pipeline, uint16_t press_depth, uint16_t release_depth)
+{
+    if (release_depth > press_depth)
+    {
+        return false;
+    }
+    p_pipeline->press_depth   = press_depth;
+    p_pipeline->release_depth = release_depth;
+    return true;
+}
+
+
+bool sensor_pipeline_sample(sensor_pipeline_t * p_pipeline, uint16_t value, uint32_t ticks)
+{
+    press_detector_config_t * p_detector_config = &p_pipeline->detector.config;
+    uint16_t                  baseline;
+    bool                      is_press;
+
+    p_pipeline->value = value;
+    p_pipeline->sample_count++;
+
+    if (!p_pipeline->baseline.is_valid)
+    {
+        baseline_tracker_update(&p_pipeline->baseline, value);
+    }
+    baseline = baseline_tracker_get(&p_pipeline->baseline);
+    p_detector_config->press_threshold   = level_below(baseline, p_pipeline->press_depth);
+    p_detector_config->release_threshold = level_below(baseline, p_pipeline->release_depth);
+
+    adc_scheduler_sample(&p_pipeline->scheduler, value, p_detector_config->press_threshold);
+    is_press = press_detector_sample(&p_pipeline->detector, value, ticks);
+
+    if ((p_pipeline->max_press_ticks != 0) &&
+        (p_pipeline->detector.state != PRESS_STATE_RELEASED) &&
+        (((ticks - p_pipeline->detector.edge_ticks) & PRESS_DETECTOR_TICK_MASK) >= p_pipeline->max_press_ticks))
+    {
+        // No real press lasts this long, the idle level has stepped down: start again from it.
+        baseline_tracker_seed(&p_pipeline->baseline, value);
+        p_pipeline->detector.state = PRESS_STATE_RELEASED;
+        p_pipeline->reseed_count++;
+    }
+    else if ((p_pipeline->detector.state == PRESS_STATE_RELEASED) &&
+             (value >= p_detector_config->press_threshold))
+    {
+        baseline_tracker_update(&p_pipeline->baseline, value);
+    }
+    else
+    {
+        baseline_tracker_hold(&p_pipeline->baseline);
+    }
+    return is_press;
+}
@@ -0,0 +1,89 @@
+/**@file
+ *
+ * @defgroup sensor_pipeline Droplet sensor processing chain
+ * @{
+ * @brief    Processing applied to each decimated sample of the droplet sensor.
+ *
+ * @details  Ties together the @ref baseline_tracker, the @ref adc_scheduler and the
+ *           @ref press_detector so the firmware and any off-target replay of recorded ADC traces
+ *           run exactly the same sequence of steps. Raw conversions are decimated by an
+ *           @ref adc_decimator_t before being fed here.
+ *
+ *           Presses are detected relative to the tracked baseline: before each sample the detector
+ *           thresholds are set press_depth and release_depth below it. The baseline is only
+ *           updated while the detector is released and the sample is above the press threshold.
+ *           A downward step of the idle level larger than press_depth (drift, temperature, a
+ *           re-seated sensor) would therefore look like a press that never ends, so a press held
+ *           for max_press_ticks restarts the baseline from the current sample and releases the
+ *           detector.
+ *
+ *           test/replay.c feeds recorded ADC traces through this module on the host and reports
+ *           detections, false positives, false negatives and latency (make -C test check).
+ *
+ * @note     This module does not touch any peripheral and can be compiled for the host.
+ */
+
+#ifndef SENSOR_PIPELINE_H__
+#define SENSOR_PIPELINE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "adc_scheduler.h"
+#include "press_detector.h"
+#include "baseline_tracker.h"
+
+/**@brief   Sensor pipeline configuration. */
+typedef struct
+{
+    adc_scheduler_config_t   scheduler;               /**< Sampling rate scheduler parameters. */
+    press_detector_config_t  detector;                /**< Press detector parameters. The thresholds are derived from the baseline and ignored here. */
+    uint16_t                 press_depth;             /**< Distance below the baseline at which a press starts. */
+    uint16_t                 release_depth;           /**< Distance below the baseline at which a press ends. Must not exceed press_depth. */
+    uint8_t                  baseline_shift;          /**< Baseline averaging shift, see @ref baseline_tracker_init. */
+    uint32_t                 max_press_ticks;         /**< Press duration after which the baseline restarts from the current sample, 0 to never restart it. */
+} sensor_pipeline_config_t;
+
+/**@brief   Sensor pipeline state. */
+typedef struct
+{
+    adc_scheduler_t          scheduler;               /**< Sampling rate scheduler. */
+    press_detector_t         detector;                /**< Press detector. */
+    baseline_tracker_t       baseline;                /**< Idle level of the sensor. */
+    uint16_t                 press_depth;             /**< Distance below the baseline at which a press starts. */
+    uint16_t                 release_depth;           /**< Distance below the baseline at which a press ends. */
+    uint32_t                 max_press_ticks;         /**< Press duration after which the baseline restarts, 0 for never. */
+    uint32_t                 reseed_count;            /**< Number of times the baseline was restarted by a press held too long. */
+    uint16_t                 value;                   /**< Latest decimated sample. */
+    uint32_t                 sample_count;            /**< Number of samples processed. */
+} sensor_pipeline_t;
+
+/**@brief       Function for initializing the pipeline.
+ *
+ * @param[out]  p_pipeline  Pipeline to initialize.
+ * @param[in]   p_config    Configuration.
+ */
+void sensor_pipeline_init(sensor_pipeline_t * p_pipeline, const sensor_pipeline_config_t * p_config);
+
+/**@brief       Function for changing the press and release depths.
+ *
+ * @param[in]   p_pipeline     Pipeline.
+ * @param[in]   press_depth    Distance below the baseline at which a press starts.
+ * @param[in]   release_depth  Distance below the baseline at which a press ends.
+ *
+ * @return      false if release_depth exceeds press_depth and the depths were rejected.
+ */
+bool sensor_pipeline_depth_set(sensor_pipeline_t * p_pipeline, uint16_t press_depth, uint16_t release_depth);
+
+/**@brief       Function for processing one decimated sample.
+ *
+ * @param[in]   p_pipeline  Pipeline.
+ * @param[in]   value       Decimated ADC sample.
+ * @param[in]   ticks       RTC timestamp of the sample.
+ *
+ * @return      true if a press is to be reported for this sample.
+ */
+bool sensor_pipeline_sample(sensor_pipeline_t * p_pipeline, uint16_t value, uint32_t ticks);
+
+#endif // SENSOR_PIPELINE_H__
+
+/** @} */
@@ -0,0 +1,156 @@
+/**@file
+ *
+ * @brief    Host stress test of the actuator mailbox with the producer and consumer on two threads.
+ *
+ * @details  The producer stands for the BLE event handler and the consumer for the actuator
+ *           context. Each command carries a sequence number in its amount. Two runs are made:
+ *
+ *           - retry: the producer posts the same command again until it is taken, so the consumer
+ *             must see every sequence number once and in order, and overflow_count must equal
+ *             the number of refused posts.
+ *           - drop: the producer moves on after a refused post, as actuator_cmd_post does, so the
+ *             consumer must see increasing sequence numbers, and the received commands plus
+ *             overflow_count must equal the posted ones.
+ *
+ *           Both sides yield from time to time, the consumer less often, so that the mailbox runs
+ *           full as well as empty. On the nRF51 both sides run on one in-order core; on the host
+ *           they may run on two cores, which is a harder test of the index ordering.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include "actuator_mailbox.h"
+
+#define STRESS_COMMANDS                 2000000                      /**< Commands posted per run. */
+#define STRESS_PRODUCER_YIELD_MASK      0x0F                         /**< The producer yields when its sequence number matches this mask. */
+#define STRESS_CONSUMER_YIELD_MASK      0x3FF                        /**< The consumer yields when its count matches this mask. */
+
+/**@brief   Results of one run. */
+typedef struct
+{
+    bool                     is_retry;                /**< The producer posts a refused command again. */
+    uint32_t                 refused;                 /**< Posts that returned false. */
+    uint32_t                 received;                /**< Commands taken by the consumer. */
+    uint32_t                 order_errors;            /**< Commands not in the expected order. */
+    uint32_t                 high_water_max;          /**< Largest high-water mark read by the producer. */
+    volatile bool            is_producer_done;        /**< Set by the producer after its last post. */
+} stress_run_t;
+
+static actuator_mailbox_t               m_mailbox;
+
+
+static void * producer_thread(void * p_arg)
+{
+    stress_run_t * p_run = p_arg;
+    actuator_cmd_t cmd   = {.type = ACTUATOR_CMD_VALUE};
+
+    for (uint32_t sequence = 0; sequence < STRESS_COMMANDS; sequence++)
+    {
+        cmd.params.amount = sequence;
+        while (!actuator_mailbox_put(&m_mailbox, &cmd))
+        {
+            p_run->refused++;
+            if (!p_run->is_retry)
+            {
+                break;
+            }
+            sched_yield();
+        }
+        if ((sequence & STRESS_PRODUCER_YIELD_MASK) == 0)
+        {
+            sched_yield();
+        }
+        if ((sequence & 0xFFFF) == 0)
+        {
+            uint8_t high_water = actuator_mailbox_high_water_get(&m_mailbox);
+
+            p_run->high_water_max = (high_water > p_run->high_water_max) ? high_water : p_run->high_water_max;
+        }
+    }
+    p_run->is_producer_done = true;
+    return NULL;
+}
+
+
+static void * consumer_thread(void * p_arg)
+{
+    stress_run_t * p_run = p_arg;
+    actuator_cmd_t cmd;
+    uint32_t       expected = 0;
+
+    for (;;)
+    {
+        // Read the flag first, so that an empty mailbox after it really means the end.
+        bool is_done = p_run->is_producer_done;
+
+        if (!actuator_mailbox_get(&m_mailbox, &cmd))
+        {
+            if (is_done)
+            {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        if ((cmd.type != ACTUATOR_CMD_VALUE) ||
+            (p_run->is_retry ? (cmd.params.amount != expected) : (cmd.params.amount < expected)))
+        {
+            p_run->order_errors++;
+        }
+        expected = cmd.params.amount + 1;
+        p_run->received++;
+        if ((p_run->received & STRESS_CONSUMER_YIELD_MASK) == 0)
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+
+static bool stress_run(bool is_retry)
+{
+    stress_run_t run = {.is_retry = is_retry};
+    pthread_t    producer, consumer;
+    bool         is_ok;
+
+    actuator_mailbox_init(&m_mailbox);
+    if ((pthread_create(&consumer, NULL, consumer_thread, &run) != 0) ||
+        (pthread_create(&producer, NULL, producer_thread, &run) != 0))
+    {
+        printf("  cannot start the threads\n");
+        return false;
+    }
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    if (is_retry)
+    {
+        is_ok = (run.received == STRESS_COMMANDS) && (m_mailbox.overflow_count == run.refused);
+    }
+    else
+    {
+        is_ok = (run.received + m_mailbox.overflow_count == STRESS_COMMANDS) &&
+                (m_mailbox.overflow_count == run.refused);
+    }
+    is_ok &= (run.order_errors == 0) && (run.high_water_max <= ACTUATOR_MAILBOX_SIZE);
+
+    printf("  %s: posted %u, received %u, refused %u, overflow_count %u, order errors %u, high water %u, %s\n",
+           is_retry ? "retry" : "drop ", STRESS_COMMANDS, run.received, run.refused,
+           m_mailbox.overflow_count, run.order_errors, run.high_water_max, is_ok ? "OK" : "FAIL");
+    return is_ok;
+}
+
+
+int main(void)
+{
+    bool is_ok = true;
+
+    printf("actuator mailbox, producer and consumer threads\n");
+    is_ok &= stress_run(true);
+    is_ok &= stress_run(false);
+    return is_ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/**@file
+ *
+ * @brief    Host check that long keyframe segments reach their value by interpolation.
+ *
+ * @details  A 60 s fade, as used for the LED decay in main.c (LED_DECAY_SEGMENT_MS), is played in
+ *           20 ms frames and then advanced to one tick before its end. At every point the output
+ *           must be within one step of the exact interpolation, so the segment does not jump to
+ *           its keyframe value when it ends. With the progress accumulated from a truncated
+ *           per-tick rate, a 0 to 255 fade stood at 239 one tick before its end.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "anim_player.h"
+
+#define TEST_SEGMENT_MS                 60000                        /**< Length of the faded segment. */
+#define TEST_FRAME_MS                   20                           /**< Frame interval of main.c. */
+
+static bool m_is_ok = true;
+
+
+/**@brief   Exact linear interpolation from from to to at elapsed out of duration ticks, with the
+ *          distance covered rounded down as in the player.
+ */
+static uint32_t linear_exact(uint8_t from, uint8_t to, uint32_t elapsed, uint32_t duration)
+{
+    if (to >= from)
+    {
+        return from + (uint32_t)((uint64_t)(to - from) * elapsed / duration);
+    }
+    return from - (uint32_t)((uint64_t)(from - to) * elapsed / duration);
+}
+
+
+static void fade_check(uint8_t from, uint8_t to)
+{
+    const anim_keyframe_t keyframes[] = {{0, from, ANIM_INTERP_STEP}, {TEST_SEGMENT_MS, to, ANIM_INTERP_LINEAR}};
+    uint32_t              duration    = ANIM_MS_TO_TICKS(TEST_SEGMENT_MS);
+    uint32_t              frame_ticks = ANIM_MS_TO_TICKS(TEST_FRAME_MS);
+    uint32_t              elapsed     = 0;
+    uint32_t              max_error   = 0;
+    uint32_t              error;
+    uint32_t              last_exact;
+    uint32_t              last_value;
+    anim_player_t         player;
+
+    anim_player_init(&player, 0);
+    anim_player_start(&player, keyframes, 2);
+    (void)anim_player_advance(&player, 0);
+
+    while (elapsed + frame_ticks < duration)
+    {
+        uint8_t  value = anim_player_advance(&player, frame_ticks);
+        uint32_t exact;
+
+        elapsed  += frame_ticks;
+        exact     = linear_exact(from, to, elapsed, duration);
+        error     = (value > exact) ? (value - exact) : (exact - value);
+        max_error = (error > max_error) ? error : max_error;
+    }
+    last_value = anim_player_advance(&player, duration - 1 - elapsed);
+    last_exact = linear_exact(from, to, duration - 1, duration);
+
+    printf("  %3u -> %3u: one tick before the end %3u, expected %3u, largest frame error %u\n",
+           from, to, last_value, last_exact, max_error);
+    m_is_ok &= (max_error <= 1);
+    m_is_ok &= (last_value + 1 >= last_exact) && (last_value <= last_exact + 1);
+    m_is_ok &= anim_player_is_running(&player);
+    m_is_ok &= (anim_player_advance(&player, 1) == to) && !anim_player_is_running(&player);
+}
+
+
+int main(void)
+{
+    printf("keyframe player, %u s linear segments in %u ms frames\n", TEST_SEGMENT_MS / 1000, TEST_FRAME_MS);
+    fade_check(0, 255);
+    fade_check(255, 0);
+    fade_check(40, 200);
+    printf("  %s\n", m_is_ok ? "OK" : "FAIL");
+    return m_is_ok ? 0 : 1;
+}
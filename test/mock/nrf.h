@@ -0,0 +1,114 @@
+/**@file
+ *
+ * @brief    Host mock of the nRF51 device header, with only what the PWM library uses.
+ *
+ * @details  The peripherals are plain structures in nrf_mock.c, so a test can read the registers the
+ *           library wrote. Tasks and events have no effect of their own.
+ */
+
+#ifndef NRF_MOCK_H__
+#define NRF_MOCK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define __INLINE                        inline
+
+typedef enum
+{
+    TIMER0_IRQn                         = 8,
+    TIMER1_IRQn                         = 9,
+    TIMER2_IRQn                         = 10,
+    RTC1_IRQn                           = 17,
+} IRQn_Type;
+
+typedef struct
+{
+    volatile uint32_t        TASKS_START;
+    volatile uint32_t        TASKS_STOP;
+    volatile uint32_t        TASKS_COUNT;
+    volatile uint32_t        TASKS_CLEAR;
+    volatile uint32_t        TASKS_CAPTURE[4];
+    volatile uint32_t        EVENTS_COMPARE[4];
+    volatile uint32_t        SHORTS;
+    volatile uint32_t        INTENSET;
+    volatile uint32_t        INTENCLR;
+    volatile uint32_t        MODE;
+    volatile uint32_t        BITMODE;
+    volatile uint32_t        PRESCALER;
+    volatile uint32_t        CC[4];
+} NRF_TIMER_Type;
+
+typedef struct
+{
+    volatile uint32_t        TASKS_START;
+    volatile uint32_t        TASKS_STOP;
+    volatile uint32_t        TASKS_CLEAR;
+    volatile uint32_t        EVENTS_COMPARE[4];
+    volatile uint32_t        INTENSET;
+    volatile uint32_t        INTENCLR;
+    volatile uint32_t        EVTENSET;
+    volatile uint32_t        COUNTER;
+    volatile uint32_t        PRESCALER;
+    volatile uint32_t        CC[4];
+} NRF_RTC_Type;
+
+typedef struct
+{
+    volatile uint32_t        TASKS_OUT[4];
+} NRF_GPIOTE_Type;
+
+typedef struct
+{
+    struct
+    {
+        volatile uint32_t    EEP;
+        volatile uint32_t    TEP;
+    }                        CH[16];
+    volatile uint32_t        CHENSET;
+} NRF_PPI_Type;
+
+typedef struct
+{
+    volatile uint32_t        PIN_CNF[32];
+} NRF_GPIO_Type;
+
+extern NRF_TIMER_Type                   nrf_mock_timer[3];
+extern NRF_RTC_Type                     nrf_mock_rtc[2];
+extern NRF_GPIOTE_Type                  nrf_mock_gpiote;
+extern NRF_PPI_Type                     nrf_mock_ppi;
+extern NRF_GPIO_Type                    nrf_mock_gpio;
+
+#define NRF_TIMER0                      (&nrf_mock_timer[0])
+#define NRF_TIMER1                      (&nrf_mock_timer[1])
+#define NRF_TIMER2                      (&nrf_mock_timer[2])
+#define NRF_RTC0                        (&nrf_mock_rtc[0])
+#define NRF_RTC1                        (&nrf_mock_rtc[1])
+#define NRF_GPIOTE                      (&nrf_mock_gpiote)
+#define NRF_PPI                         (&nrf_mock_ppi)
+#define NRF_GPIO                        (&nrf_mock_gpio)
+
+#define TIMER_BITMODE_BITMODE_16Bit     0
+#define TIMER_MODE_MODE_Timer           0
+#define TIMER_MODE_MODE_Counter         1
+#define TIMER_SHORTS_COMPARE0_CLEAR_Msk (1UL << 0)
+#define TIMER_SHORTS_COMPARE2_CLEAR_Msk (1UL << 2)
+#define TIMER_INTENSET_COMPARE0_Msk     (1UL << 16)
+#define TIMER_INTENSET_COMPARE2_Msk     (1UL << 18)
+#define TIMER_INTENCLR_COMPARE2_Msk     (1UL << 18)
+#define RTC_INTENSET_COMPARE0_Msk       (1UL << 16)
+#define RTC_INTENCLR_COMPARE0_Msk       (1UL << 16)
+#define RTC_EVTEN_COMPARE0_Msk          (1UL << 16)
+#define RTC_EVTEN_COMPARE1_Msk          (1UL << 17)
+#define GPIO_PIN_CNF_INPUT_Msk          (1UL << 1)
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_SetPendingIRQ(IRQn_Type irq);
+
+/**@brief   Function for mapping the registers the library writes by address (PAN 73 workaround),
+ *          called before nrf_pwm_init.
+ */
+void nrf_mock_init(void);
+
+#endif // NRF_MOCK_H__
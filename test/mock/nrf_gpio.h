@@ -0,0 +1,19 @@
+/**@file
+ *
+ * @brief    Host mock of the GPIO functions used by the PWM library. The pin levels are kept.
+ */
+
+#ifndef NRF_GPIO_MOCK_H__
+#define NRF_GPIO_MOCK_H__
+
+#include <stdint.h>
+
+extern uint32_t                         nrf_mock_pin_level[32];
+
+void nrf_gpio_cfg_output(uint32_t pin_number);
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value);
+void nrf_gpio_pin_set(uint32_t pin_number);
+void nrf_gpio_pin_clear(uint32_t pin_number);
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+
+#endif // NRF_GPIO_MOCK_H__
@@ -0,0 +1,73 @@
+/**@file
+ *
+ * @brief    Host mock peripherals and SoftDevice calls for the PWM library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "nrf.h"
+#include "nrf_gpio.h"
+#include "nrf_gpiote.h"
+#include "nrf_soc.h"
+
+#define NRF_MOCK_PAN73_BASE             0x40008000UL                 /**< Page of the TIMER0 PAN 73 register, TIMER1 and TIMER2 follow. */
+#define NRF_MOCK_PAN73_SIZE             0x3000UL
+
+NRF_TIMER_Type                          nrf_mock_timer[3];
+NRF_RTC_Type                            nrf_mock_rtc[2];
+NRF_GPIOTE_Type                         nrf_mock_gpiote;
+NRF_PPI_Type                            nrf_mock_ppi;
+NRF_GPIO_Type                           nrf_mock_gpio;
+uint32_t                                nrf_mock_pin_level[32];
+nrf_mock_radio_t                        nrf_mock_radio;
+
+
+void nrf_mock_init(void)
+{
+    static bool is_mapped;
+
+    if (!is_mapped &&
+        (mmap((void *)NRF_MOCK_PAN73_BASE, NRF_MOCK_PAN73_SIZE, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) == MAP_FAILED))
+    {
+        perror("mapping the timer registers");
+        exit(2);
+    }
+    is_mapped = true;
+}
+
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) {}
+void NVIC_EnableIRQ(IRQn_Type irq) {}
+void NVIC_SetPendingIRQ(IRQn_Type irq) {}
+
+void nrf_gpio_cfg_output(uint32_t pin_number) {}
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value) { nrf_mock_pin_level[pin_number] = (value != 0); }
+void nrf_gpio_pin_set(uint32_t pin_number) { nrf_mock_pin_level[pin_number] = 1; }
+void nrf_gpio_pin_clear(uint32_t pin_number) { nrf_mock_pin_level[pin_number] = 0; }
+uint32_t nrf_gpio_pin_read(uint32_t pin_number) { return nrf_mock_pin_level[pin_number]; }
+
+void nrf_gpiote_task_config(uint32_t channel_number, uint32_t pin_number,
+                            nrf_gpiote_polarity_t polarity, nrf_gpiote_outinit_t initial_value) {}
+void nrf_gpiote_unconfig(uint32_t channel_number) {}
+
+
+uint32_t sd_radio_session_open(nrf_radio_signal_callback_t p_radio_signal_callback)
+{
+    nrf_mock_radio.p_callback = p_radio_signal_callback;
+    return 0;
+}
+
+
+uint32_t sd_radio_request(nrf_radio_request_t * p_request)
+{
+    nrf_mock_radio.request_count++;
+    return 0;
+}
+
+
+uint32_t sd_ppi_channel_assign(uint8_t channel_num, const volatile void * evt_endpoint, const volatile void * task_endpoint) { return 0; }
+uint32_t sd_ppi_channel_enable_set(uint32_t channel_enable_set_msk) { return 0; }
+uint32_t sd_nvic_SetPriority(IRQn_Type irq, uint32_t priority) { return 0; }
+uint32_t sd_nvic_EnableIRQ(IRQn_Type irq) { return 0; }
@@ -0,0 +1,11 @@
+/**@file
+ *
+ * @brief    Host mock of the SoftDevice manager header, the PWM library only needs nrf_soc.h.
+ */
+
+#ifndef NRF_SDM_MOCK_H__
+#define NRF_SDM_MOCK_H__
+
+#include "nrf_soc.h"
+
+#endif // NRF_SDM_MOCK_H__
@@ -0,0 +1,100 @@
+/**@file
+ *
+ * @brief    Host mock of the SoftDevice SoC API used by the PWM library.
+ *
+ * @details  The radio timeslot calls are recorded in nrf_mock_radio, so a test can count the
+ *           requests and run the signal callback as the SoftDevice would at the start of a slot.
+ */
+
+#ifndef NRF_SOC_MOCK_H__
+#define NRF_SOC_MOCK_H__
+
+#include <stdint.h>
+#include "nrf.h"
+
+enum
+{
+    NRF_EVT_HFCLKSTARTED,
+    NRF_EVT_POWER_FAILURE_WARNING,
+    NRF_EVT_FLASH_OPERATION_SUCCESS,
+    NRF_EVT_FLASH_OPERATION_ERROR,
+    NRF_EVT_RADIO_BLOCKED,
+    NRF_EVT_RADIO_CANCELED,
+    NRF_EVT_RADIO_SIGNAL_CALLBACK_INVALID_RETURN,
+    NRF_EVT_RADIO_SESSION_IDLE,
+    NRF_EVT_RADIO_SESSION_CLOSED,
+};
+
+enum
+{
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_START,
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_TIMER0,
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_RADIO,
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_FAILED,
+    NRF_RADIO_CALLBACK_SIGNAL_TYPE_EXTEND_SUCCEEDED,
+};
+
+enum
+{
+    NRF_RADIO_SIGNAL_CALLBACK_ACTION_NONE,
+    NRF_RADIO_SIGNAL_CALLBACK_ACTION_EXTEND,
+    NRF_RADIO_SIGNAL_CALLBACK_ACTION_END,
+    NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END,
+};
+
+enum { NRF_RADIO_REQ_TYPE_EARLIEST, NRF_RADIO_REQ_TYPE_NORMAL };
+enum { NRF_RADIO_HFCLK_CFG_DEFAULT, NRF_RADIO_HFCLK_CFG_FORCE_XTAL };
+enum { NRF_RADIO_PRIORITY_HIGH, NRF_RADIO_PRIORITY_NORMAL };
+
+typedef struct
+{
+    uint8_t                  hfclk;
+    uint8_t                  priority;
+    uint32_t                 length_us;
+    uint32_t                 timeout_us;
+} nrf_radio_request_earliest_t;
+
+typedef struct
+{
+    uint8_t                  request_type;
+    union
+    {
+        nrf_radio_request_earliest_t earliest;
+    } params;
+} nrf_radio_request_t;
+
+typedef struct
+{
+    uint8_t                  callback_action;
+    union
+    {
+        struct
+        {
+            nrf_radio_request_t * p_next;
+        } request;
+        struct
+        {
+            uint32_t         length_us;
+        } extend;
+    } params;
+} nrf_radio_signal_callback_return_param_t;
+
+typedef nrf_radio_signal_callback_return_param_t * (*nrf_radio_signal_callback_t)(uint8_t signal_type);
+
+/**@brief   Recorded radio timeslot calls. */
+typedef struct
+{
+    nrf_radio_signal_callback_t p_callback;           /**< Callback passed to sd_radio_session_open. */
+    uint32_t                 request_count;           /**< Calls to sd_radio_request. */
+} nrf_mock_radio_t;
+
+extern nrf_mock_radio_t                 nrf_mock_radio;
+
+uint32_t sd_radio_session_open(nrf_radio_signal_callback_t p_radio_signal_callback);
+uint32_t sd_radio_request(nrf_radio_request_t * p_request);
+uint32_t sd_ppi_channel_assign(uint8_t channel_num, const volatile void * evt_endpoint, const volatile void * task_endpoint);
+uint32_t sd_ppi_channel_enable_set(uint32_t channel_enable_set_msk);
+uint32_t sd_nvic_SetPriority(IRQn_Type irq, uint32_t priority);
+uint32_t sd_nvic_EnableIRQ(IRQn_Type irq);
+
+#endif // NRF_SOC_MOCK_H__
@@ -0,0 +1,89 @@
+/**@file
+ *
+ * @brief    Host check that the motor drive profile does not depend on the frame rate.
+ *
+ * @details  The same patterns are played through an @ref anim_mixer_t and the drive profile at
+ *           several frame intervals. A fade must come out unchanged at every interval, even when it
+ *           moves by more than the edge threshold per frame, and a step keyframe must get its
+ *           kick-start or brake at every interval.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "anim_mixer.h"
+#include "motor_profile.h"
+
+// Defaults of main.c.
+#define MOTOR_KICK_LEVEL                255
+#define MOTOR_KICK_MS                   30
+#define MOTOR_BRAKE_MS                  30
+#define MOTOR_EDGE_THRESHOLD            40
+
+#define TEST_DURATION_MS                200                          /**< Time each pattern is played for. */
+
+static const motor_profile_config_t m_config = {MOTOR_KICK_LEVEL, MOTOR_KICK_MS, MOTOR_BRAKE_MS, MOTOR_EDGE_THRESHOLD};
+
+/**@brief   255 held for 50 ms, past its kick-start, then a 60 ms linear fade to 0. */
+static const anim_keyframe_t m_fade[]  = {{0, 255, ANIM_INTERP_STEP}, {50, 255, ANIM_INTERP_STEP}, {60, 0, ANIM_INTERP_LINEAR}};
+
+/**@brief   255 held for 60 ms, then a step down to 100, held. */
+static const anim_keyframe_t m_brake[] = {{0, 255, ANIM_INTERP_STEP}, {60, 255, ANIM_INTERP_STEP}, {0, 100, ANIM_INTERP_STEP}, {100, 100, ANIM_INTERP_STEP}};
+
+/**@brief   A step from 0 to a level below the kick level, held. */
+static const anim_keyframe_t m_kick[]  = {{0, 100, ANIM_INTERP_STEP}, {100, 100, ANIM_INTERP_STEP}};
+
+
+/**@brief   Plays a pattern and counts the frames where the drive differs from the pattern level.
+ *
+ * @param[out]  p_zero_count    Frames with a zero drive for a non-zero level.
+ * @param[out]  p_kick_count    Frames with the kick level as drive for a lower level.
+ */
+static void pattern_play(const anim_keyframe_t * p_keyframes, uint8_t count, uint32_t frame_ms,
+                         uint32_t * p_zero_count, uint32_t * p_kick_count)
+{
+    anim_mixer_t    mixer;
+    motor_profile_t profile;
+    uint32_t        frame_ticks = ANIM_MS_TO_TICKS(frame_ms);
+
+    anim_mixer_init(&mixer, 0);
+    motor_profile_init(&profile);
+    anim_mixer_submit(&mixer, ANIM_POLICY_REPLACE, p_keyframes, count, &m_config);
+
+    *p_zero_count = 0;
+    *p_kick_count = 0;
+    for (uint32_t t = 0; t <= TEST_DURATION_MS; t += frame_ms)
+    {
+        uint8_t level = anim_mixer_advance(&mixer, (t == 0) ? 0 : frame_ticks);
+        uint8_t drive = motor_profile_apply(&profile, &m_config, level, mixer.is_step, (t == 0) ? 0 : frame_ticks);
+
+        *p_zero_count += (drive == 0) && (level != 0);
+        *p_kick_count += (drive == MOTOR_KICK_LEVEL) && (level < MOTOR_KICK_LEVEL);
+    }
+}
+
+
+int main(void)
+{
+    static const uint32_t frame_ms[] = {1, 5, 10, 20};
+    bool                  is_ok = true;
+
+    printf("motor drive profile, frame interval independence\n");
+    for (uint32_t i = 0; i < sizeof(frame_ms) / sizeof(frame_ms[0]); i++)
+    {
+        uint32_t fade_zero, fade_kick, brake_zero, brake_kick, kick_zero, kick_kick;
+
+        pattern_play(m_fade, 3, frame_ms[i], &fade_zero, &fade_kick);
+        pattern_play(m_brake, 4, frame_ms[i], &brake_zero, &brake_kick);
+        pattern_play(m_kick, 2, frame_ms[i], &kick_zero, &kick_kick);
+
+        printf("  %2u ms frames: fade %u cut frames, step down %u brake frames, step up %u kick frames\n",
+               frame_ms[i], fade_zero, brake_zero, kick_kick);
+        if ((fade_zero != 0) || (fade_kick != 0) || (brake_zero == 0) || (kick_kick == 0))
+        {
+            is_ok = false;
+        }
+    }
+    printf("  %s\n", is_ok ? "OK" : "FAIL");
+    return is_ok ? 0 : 1;
+}
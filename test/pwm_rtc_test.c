@@ -0,0 +1,120 @@
+/**@file
+ *
+ * @brief    Host test of the RTC backend of the PWM library.
+ *
+ * @details  nrf_pwm.c is built with PWM_RTC_ENABLED=1 and without a SoftDevice against the mocks in
+ *           mock/, with channel 0 on the RTC. The mock RTC counter never moves, so each case sets
+ *           PWM_RTC->COUNTER and runs the RTC interrupt handler as the period event would. Values are
+ *           in the 0-100 range of PWM_MODE_LED_100, scaled to 256 RTC ticks. The test checks that:
+ *
+ *           - the last tick of a period counts as the start of the next one;
+ *           - with the counter before, between or after the old and the new compare point, the
+ *             output gets one GPIOTE toggle exactly when it would not end the period low;
+ *           - the compare point is at least 3 ticks, so a value applied at the period start is never
+ *             left;
+ *           - a channel whose new or old compare point is 0-2 ticks from the counter is left for the
+ *             next period, with the period interrupt still enabled, and applied there.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf.h"
+#include "nrf_pwm.h"
+
+#define TEST_GPIOTE_CHANNEL             2                            /**< gpiote_channel[0] of PWM_DEFAULT_CONFIG. */
+
+void PWM_RTC_IRQHandler(void);
+
+static bool m_is_ok = true;
+
+
+/**@brief   Runs the RTC interrupt with the counter at @p counter after setting channel 0 to @p value.
+ *
+ * @return  true if the channel was applied, which disables the period interrupt.
+ */
+static bool rtc_update_run(uint32_t counter, uint32_t value)
+{
+    nrf_pwm_set_value(0, value);
+    PWM_RTC->COUNTER = counter;
+    PWM_RTC->INTENCLR = 0;
+    NRF_GPIOTE->TASKS_OUT[TEST_GPIOTE_CHANNEL] = 0;
+    PWM_RTC_IRQHandler();
+    return PWM_RTC->INTENCLR == RTC_INTENCLR_COMPARE0_Msk;
+}
+
+
+static void check(bool is_applied, uint32_t compare, bool is_toggled, const char * p_what)
+{
+    bool is_ok = is_applied && (PWM_RTC->CC[1] == compare) &&
+                 ((NRF_GPIOTE->TASKS_OUT[TEST_GPIOTE_CHANNEL] == 1) == is_toggled);
+
+    printf("  %-58s CC %3u %s  %s\n", p_what, PWM_RTC->CC[1], is_toggled ? "toggle" : "      ", is_ok ? "OK" : "FAIL");
+    m_is_ok &= is_ok;
+}
+
+
+static void deferred_check(bool is_applied, uint32_t compare, const char * p_what)
+{
+    bool is_ok = !is_applied && (PWM_RTC->CC[1] == compare) && (NRF_GPIOTE->TASKS_OUT[TEST_GPIOTE_CHANNEL] == 0);
+
+    printf("  %-58s CC %3u         %s\n", p_what, PWM_RTC->CC[1], is_ok ? "OK" : "FAIL");
+    m_is_ok &= is_ok;
+}
+
+
+int main(void)
+{
+    nrf_pwm_config_t config = PWM_DEFAULT_CONFIG;
+    bool             is_applied;
+
+    nrf_mock_init();
+    config.rtc_channel_mask = 1 << 0;
+    if (nrf_pwm_init(&config) != 0)
+    {
+        printf("nrf_pwm_init failed\n");
+        return 2;
+    }
+
+    printf("PWM library, RTC backend updates\n");
+
+    // 20% is 51 ticks. The output was just set up high and the compare point is ahead
+    is_applied = rtc_update_run(255, 20);
+    check(is_applied, 51, false, "last tick of the period, channel started");
+
+    is_applied = rtc_update_run(40, 40);
+    check(is_applied, 102, false, "counter before both compare points");
+
+    // The old point has set it low, the new one would toggle it back high
+    is_applied = rtc_update_run(130, 80);
+    check(is_applied, 205, true, "counter between, new point ahead");
+
+    is_applied = rtc_update_run(230, 60);
+    check(is_applied, 154, false, "counter after both compare points");
+
+    // Neither point toggles in this period, the output would stay high
+    is_applied = rtc_update_run(100, 20);
+    check(is_applied, 51, true, "counter between, old point ahead");
+
+    // 1% is 2.56 ticks, clamped to 3 and still ahead of a counter read at the period start
+    is_applied = rtc_update_run(0, 1);
+    check(is_applied, 3, false, "first tick of the period, 3 tick minimum");
+
+    // 51 is one tick ahead of the counter, it may or may not match
+    is_applied = rtc_update_run(50, 20);
+    deferred_check(is_applied, 3, "new point 1 tick ahead, deferred");
+    is_applied = rtc_update_run(255, 20);
+    check(is_applied, 51, false, "applied at the next period start");
+
+    // The old point 51 may be matching as the counter moves on from 50
+    is_applied = rtc_update_run(50, 80);
+    deferred_check(is_applied, 51, "old point 1 tick ahead, deferred");
+    is_applied = rtc_update_run(255, 80);
+    check(is_applied, 205, false, "applied at the next period start");
+
+    // 154 is 2 ticks ahead, the counter may reach 153 before the write
+    is_applied = rtc_update_run(152, 60);
+    deferred_check(is_applied, 205, "new point 2 ticks ahead, deferred");
+
+    return m_is_ok ? 0 : 1;
+}
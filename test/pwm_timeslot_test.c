@@ -0,0 +1,258 @@
+/**@file
+ *
+ * @brief    Host test of the radio timeslot requests of the PWM library with a SoftDevice.
+ *
+ * @details  nrf_pwm.c is built with USE_WITH_SOFTDEVICE=1 against the mocks in mock/, where
+ *           sd_radio_request only counts the calls. A timeslot is started by running the signal
+ *           callback passed to sd_radio_session_open, as the SoftDevice does. The test checks that:
+ *
+ *           - a burst of nrf_pwm_set_value calls on several channels costs one request;
+ *           - calls made while a request is pending do not make another, and the first call after
+ *             the slot has started does;
+ *           - a blocked or canceled request is made again, once per event, and only while values
+ *             are still waiting;
+ *           - inside a transaction, nested or not, nrf_pwm_set_value makes no request and the
+ *             outermost commit makes one;
+ *           - a running channel is updated without waiting for the counter, with one GPIOTE toggle
+ *             when the counter lies between the old and the new compare point, and is left for the
+ *             next timeslot near the end of the period. SIGALRM fails the test if an update spins;
+ *           - without PWM_SEQ_ENABLED the waveform sequencer leaves PWM_SEQ_TIMER alone;
+ *           - nrf_pwm_set_frequency picks the slowest prescaler giving min_resolution steps, reports
+ *             the timing it set, and refuses frequencies the timer cannot reach. It runs last, as it
+ *             changes the period the other cases use.
+ *
+ *           The mock counter is PWM_TIMER->CC[3], the register TASKS_CAPTURE[3] reads.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <unistd.h>
+#include "nrf.h"
+#include "nrf_soc.h"
+#include "nrf_pwm.h"
+
+#define TEST_BURST_LENGTH               50                           /**< nrf_pwm_set_value calls in a burst. */
+#define TEST_GPIOTE_CHANNEL             2                            /**< gpiote_channel[0] of PWM_DEFAULT_CONFIG. */
+#define TEST_SPIN_TIMEOUT_S             2                            /**< An update still running after this spins. */
+
+static bool m_is_ok = true;
+
+
+static void check(bool condition, const char * p_what, uint32_t requests)
+{
+    printf("  %-58s requests %u  %s\n", p_what, requests, condition ? "OK" : "FAIL");
+    m_is_ok &= condition;
+}
+
+
+/**@brief   Runs a timeslot, as the SoftDevice does once the pending request is granted. */
+static void timeslot_run(void)
+{
+    (void)nrf_mock_radio.p_callback(NRF_RADIO_CALLBACK_SIGNAL_TYPE_START);
+}
+
+
+static void burst_test(void)
+{
+    uint32_t start = nrf_mock_radio.request_count;
+
+    // The values stay above the update margin, the mock counter never moves.
+    for (uint32_t i = 0; i < TEST_BURST_LENGTH; i++)
+    {
+        nrf_pwm_set_value(0, 10 + i);
+        nrf_pwm_set_value(1, 60 - i);
+    }
+    check(nrf_mock_radio.request_count - start == 1, "burst on two channels", nrf_mock_radio.request_count - start);
+
+    timeslot_run();
+    check((PWM_TIMER->CC[0] == 10 + TEST_BURST_LENGTH - 1) && (PWM_TIMER->CC[1] == 60 - (TEST_BURST_LENGTH - 1)),
+          "timeslot applies the last values", nrf_mock_radio.request_count - start);
+}
+
+
+static void pending_test(void)
+{
+    uint32_t start = nrf_mock_radio.request_count;
+
+    nrf_pwm_set_value(0, 20);
+    nrf_pwm_set_value(0, 21);
+    nrf_pwm_set_values(2, (uint32_t[]){22, 23});
+    check(nrf_mock_radio.request_count - start == 1, "calls while a slot is pending", nrf_mock_radio.request_count - start);
+
+    timeslot_run();
+    nrf_pwm_set_value(1, 24);
+    check(nrf_mock_radio.request_count - start == 2, "first call after the slot started", nrf_mock_radio.request_count - start);
+    timeslot_run();
+    check(PWM_TIMER->CC[1] == 24, "second slot applies it", nrf_mock_radio.request_count - start);
+}
+
+
+static void sys_event_test(void)
+{
+    uint32_t start = nrf_mock_radio.request_count;
+
+    nrf_pwm_set_value(0, 30);
+    nrf_pwm_sys_event_handler(NRF_EVT_RADIO_BLOCKED);
+    check(nrf_mock_radio.request_count - start == 2, "blocked request is made again", nrf_mock_radio.request_count - start);
+    nrf_pwm_sys_event_handler(NRF_EVT_RADIO_CANCELED);
+    check(nrf_mock_radio.request_count - start == 3, "canceled request is made again", nrf_mock_radio.request_count - start);
+    nrf_pwm_sys_event_handler(NRF_EVT_RADIO_SESSION_IDLE);
+    nrf_pwm_sys_event_handler(NRF_EVT_FLASH_OPERATION_SUCCESS);
+    check(nrf_mock_radio.request_count - start == 3, "other system events are ignored", nrf_mock_radio.request_count - start);
+
+    timeslot_run();
+    nrf_pwm_sys_event_handler(NRF_EVT_RADIO_BLOCKED);
+    nrf_pwm_sys_event_handler(NRF_EVT_RADIO_CANCELED);
+    check((nrf_mock_radio.request_count - start == 3) && (PWM_TIMER->CC[0] == 30),
+          "blocked or canceled with nothing waiting", nrf_mock_radio.request_count - start);
+}
+
+
+static void transaction_test(void)
+{
+    uint32_t start = nrf_mock_radio.request_count;
+
+    nrf_pwm_update_begin();
+    nrf_pwm_set_value(0, 40);
+    nrf_pwm_update_begin();
+    nrf_pwm_set_value(1, 41);
+    nrf_pwm_update_stage(0, 42);
+    nrf_pwm_update_commit();
+    check(nrf_mock_radio.request_count - start == 0, "set_value and inner commit in a transaction", nrf_mock_radio.request_count - start);
+    nrf_pwm_update_commit();
+    check(nrf_mock_radio.request_count - start == 1, "outermost commit", nrf_mock_radio.request_count - start);
+
+    timeslot_run();
+    check((PWM_TIMER->CC[0] == 42) && (PWM_TIMER->CC[1] == 41), "slot applies the committed values", nrf_mock_radio.request_count - start);
+}
+
+
+static void spin_alarm_handler(int signal)
+{
+    (void)signal;
+    printf("  update waited for the counter to move, the mock counter never does  FAIL\n");
+    _exit(1);
+}
+
+
+/**@brief   Runs a timeslot with the counter at @p counter and returns the callback action. */
+static uint8_t timeslot_run_at(uint32_t counter)
+{
+    nrf_radio_signal_callback_return_param_t * p_return;
+
+    PWM_TIMER->CC[3] = counter;
+    NRF_GPIOTE->TASKS_OUT[TEST_GPIOTE_CHANNEL] = 0;
+    alarm(TEST_SPIN_TIMEOUT_S);
+    p_return = nrf_mock_radio.p_callback(NRF_RADIO_CALLBACK_SIGNAL_TYPE_START);
+    alarm(0);
+    return p_return->callback_action;
+}
+
+
+static void wait_free_test(void)
+{
+    uint32_t start = nrf_mock_radio.request_count;
+    uint8_t  action;
+
+    signal(SIGALRM, spin_alarm_handler);
+    nrf_pwm_set_value(0, 40);
+    (void)timeslot_run_at(0);
+
+    // Right before the old compare point: neither has toggled yet, the new one will, once
+    nrf_pwm_set_value(0, 45);
+    action = timeslot_run_at(39);
+    check((PWM_TIMER->CC[0] == 45) && (NRF_GPIOTE->TASKS_OUT[TEST_GPIOTE_CHANNEL] == 0) &&
+          (action == NRF_RADIO_SIGNAL_CALLBACK_ACTION_END),
+          "counter before both compare points, no toggle", nrf_mock_radio.request_count - start);
+
+    // Between them: the old one has toggled and the new one will again, the output needs a correction
+    nrf_pwm_set_value(0, 50);
+    action = timeslot_run_at(47);
+    check((PWM_TIMER->CC[0] == 50) && (NRF_GPIOTE->TASKS_OUT[TEST_GPIOTE_CHANNEL] == 1) &&
+          (action == NRF_RADIO_SIGNAL_CALLBACK_ACTION_END),
+          "counter between compare points, one toggle", nrf_mock_radio.request_count - start);
+
+    // Within the update margin of the period end: left for the next timeslot
+    nrf_pwm_set_value(0, 55);
+    action = timeslot_run_at(99);
+    check((PWM_TIMER->CC[0] == 50) && (NRF_GPIOTE->TASKS_OUT[TEST_GPIOTE_CHANNEL] == 0) &&
+          (action == NRF_RADIO_SIGNAL_CALLBACK_ACTION_REQUEST_AND_END),
+          "counter at the period end, deferred", nrf_mock_radio.request_count - start);
+    action = timeslot_run_at(10);
+    check((PWM_TIMER->CC[0] == 55) && (action == NRF_RADIO_SIGNAL_CALLBACK_ACTION_END),
+          "next timeslot applies it", nrf_mock_radio.request_count - start);
+    PWM_TIMER->CC[3] = 0;
+}
+
+
+static void sequencer_test(void)
+{
+    static const uint16_t values[] = {10, 20};
+
+    check((nrf_pwm_sequence_start(1, values, 2, 1, false) == 0xFFFFFFFF) && !nrf_pwm_sequence_is_running() &&
+          (PWM_SEQ_TIMER->INTENSET == 0) && (PWM_SEQ_TIMER->TASKS_START == 0),
+          "sequencer off, its timer untouched", nrf_mock_radio.request_count);
+}
+
+
+/**@brief   Checks one nrf_pwm_set_frequency call against the expected prescaler and period. */
+static void frequency_check(uint32_t frequency_hz, uint32_t min_resolution, uint32_t prescaler,
+                            uint32_t max_value, uint32_t achieved_hz, const char * p_what)
+{
+    nrf_pwm_timing_t achieved = {0};
+    uint32_t         err_code = nrf_pwm_set_frequency(frequency_hz, min_resolution, &achieved);
+
+    check((err_code == 0) && (achieved.prescaler == prescaler) && (achieved.max_value == max_value) &&
+          (achieved.frequency_hz == achieved_hz) && (PWM_TIMER->PRESCALER == prescaler) &&
+          (PWM_TIMER->CC[2] == max_value),
+          p_what, nrf_mock_radio.request_count);
+}
+
+
+static void frequency_test(void)
+{
+    nrf_pwm_timing_t achieved = {0};
+
+    // 31.25 kHz and 62.5 kHz give 31 and 63 steps at 1 kHz, 125 kHz is the slowest clock with 100
+    frequency_check(1000, 100, 7, 125, 1000, "1 kHz, 100 steps: prescaler 7");
+    // More steps at the same frequency need a faster clock
+    frequency_check(1000, 1000, 4, 1000, 1000, "1 kHz, 1000 steps: prescaler 4");
+    // The period is rounded to whole ticks, 31250 / 333 = 93.8 ticks, and the frequency it gives is reported
+    frequency_check(333, 90, 9, 94, 332, "333 Hz, 90 steps: 94 ticks, 332 Hz");
+
+    check(nrf_pwm_set_frequency(0, 1, &achieved) == 0xFFFFFFFF, "0 Hz refused", nrf_mock_radio.request_count);
+    check(nrf_pwm_set_frequency(1000000, 100, &achieved) == 0xFFFFFFFF, "1 MHz, 100 steps refused: 16 at most",
+          nrf_mock_radio.request_count);
+    // 160 ticks at 16 MHz leave no room for twice the 80 tick update margin
+    check(nrf_pwm_set_frequency(100000, 100, &achieved) == 0xFFFFFFFF, "100 kHz, 100 steps refused: update margin",
+          nrf_mock_radio.request_count);
+    check(nrf_pwm_set_frequency(1, 70000, &achieved) == 0xFFFFFFFF, "1 Hz, 70000 steps refused: 16-bit period",
+          nrf_mock_radio.request_count);
+    check((achieved.prescaler == 0) && (achieved.max_value == 0) && (PWM_TIMER->PRESCALER == 9) && (PWM_TIMER->CC[2] == 94),
+          "refused calls leave the timing alone", nrf_mock_radio.request_count);
+}
+
+
+int main(void)
+{
+    nrf_pwm_config_t config = PWM_DEFAULT_CONFIG;
+
+    nrf_mock_init();
+    if (nrf_pwm_init(&config) != 0)
+    {
+        printf("nrf_pwm_init failed\n");
+        return 2;
+    }
+
+    printf("PWM library, radio timeslot requests\n");
+    burst_test();
+    pending_test();
+    sys_event_test();
+    transaction_test();
+    wait_free_test();
+    sequencer_test();
+    frequency_test();
+    return m_is_ok ? 0 : 1;
+}
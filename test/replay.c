@@ -0,0 +1,345 @@
+/**@file
+ *
+ * @brief    Host replay of recorded droplet sensor traces through the press detection chain.
+ *
+ * @details  Each trace is a CSV file of raw ADC conversions, one per line, as
+ *           "ticks,raw,pressed": the RTC timestamp of the sampling tick, the 10-bit conversion and
+ *           1 while the sensor was really pressed. Lines starting with '#' are comments, and a
+ *           "# expect detections=N fp=N fn=N" comment gives the results the trace must produce.
+ *
+ *           The conversions are written to a mock NRF_ADC and taken from it by the same steps as
+ *           ADC_IRQHandler (ring buffer) and adc_samples_process (decimator and sensor pipeline),
+ *           so a threshold or filter change can be checked against recordings before it is
+ *           flashed. A detection is matched to the labelled press it falls in, or to one that
+ *           ended less than REPLAY_MATCH_TAIL_MS earlier; the others are false positives, and
+ *           labelled presses without a detection are false negatives.
+ *
+ *           The traces in traces/ are synthetic, generated with the noise, drift and press shapes
+ *           described in their header comments. Each one is sampled at a fixed 5 ms tick, and the
+ *           replay follows the trace timestamps: the rate changes asked by the @ref adc_scheduler
+ *           are not simulated. The tuning is taken from sensor_config.h, as in main.c.
+ *
+ *           The processing time is measured on the host over the whole replay, in TSC cycles where
+ *           available and in ns, so it is only meant for comparing changes, not as a Cortex-M0
+ *           cycle count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define REPLAY_HAS_TSC                  1
+#else
+#define REPLAY_HAS_TSC                  0
+#endif
+#include "adc_filter.h"
+#include "sensor_pipeline.h"
+#include "sensor_config.h"
+
+
+#define REPLAY_MATCH_TAIL_MS            50                           /**< Detections this long after a labelled press still match it. */
+#define MS_TO_TICKS(MS)                 ((uint32_t)(MS) * 32768 / 1000)
+#define TICKS_TO_US(TICKS)              ((uint64_t)(TICKS) * 1000000 / 32768)
+
+/**@brief   One raw conversion of a trace. */
+typedef struct
+{
+    uint32_t                 ticks;                   /**< RTC timestamp of the sampling tick. */
+    uint16_t                 raw;                     /**< Raw conversion. */
+    bool                     is_pressed;              /**< true while the sensor was really pressed. */
+} replay_sample_t;
+
+/**@brief   Loaded trace. */
+typedef struct
+{
+    replay_sample_t *        p_samples;               /**< Conversions, in order. */
+    uint32_t                 count;                   /**< Number of conversions. */
+    bool                     has_expect;              /**< true if the trace gives expected results. */
+    uint32_t                 expect_detections;       /**< Expected number of detections. */
+    uint32_t                 expect_fp;               /**< Expected number of false positives. */
+    uint32_t                 expect_fn;               /**< Expected number of false negatives. */
+} replay_trace_t;
+
+/**@brief   Mock of the ADC registers read by ADC_IRQHandler. */
+typedef struct
+{
+    volatile uint32_t        EVENTS_END;
+    volatile uint32_t        RESULT;
+} replay_adc_t;
+
+static replay_adc_t                     m_adc;
+#define NRF_ADC                         (&m_adc)
+
+static adc_ring_t                       m_ring;
+static adc_decimator_t                  m_decimator;
+static sensor_pipeline_t                m_sensor;
+static uint32_t                         m_channel_ticks;
+
+
+/**@brief   Same data path as ADC_IRQHandler: the result goes to the ring buffer. */
+static void replay_adc_irq_handler(void)
+{
+    NRF_ADC->EVENTS_END = 0;
+    (void)adc_ring_put(&m_ring, (uint16_t)NRF_ADC->RESULT);
+}
+
+
+static void replay_sensor_init(void)
+{
+    sensor_pipeline_config_t sensor_config;
+
+    adc_ring_init(&m_ring);
+    adc_decimator_init(&m_decimator, ADC_OVERSAMPLE_LOG2);
+
+    sensor_config.scheduler.near_band          = ADC_SCHED_NEAR_BAND;
+    sensor_config.scheduler.change_delta       = ADC_SCHED_CHANGE_DELTA;
+    sensor_config.scheduler.quiet_samples      = ADC_SCHED_QUIET_SAMPLES;
+    sensor_config.detector.press_threshold     = 0;
+    sensor_config.detector.release_threshold   = 0;
+    sensor_config.detector.dwell_ticks         = MS_TO_TICKS(SENSOR_DWELL_MS);
+    sensor_config.detector.refractory_ticks    = MS_TO_TICKS(SENSOR_REFRACTORY_MS);
+    sensor_config.press_depth                  = SENSOR_PRESS_DEPTH;
+    sensor_config.release_depth                = SENSOR_RELEASE_DEPTH;
+    sensor_config.baseline_shift               = SENSOR_BASELINE_SHIFT;
+    sensor_config.max_press_ticks              = MS_TO_TICKS(SENSOR_MAX_PRESS_MS);
+    sensor_pipeline_init(&m_sensor, &sensor_config);
+}
+
+
+/**@brief   Feeds one conversion through the chain.
+ *
+ * @return  true if it completed a decimated sample that reported a press.
+ */
+static bool replay_conversion(const replay_sample_t * p_sample)
+{
+    uint16_t raw;
+    uint16_t filtered;
+    bool     is_press = false;
+
+    NRF_ADC->RESULT     = p_sample->raw;
+    NRF_ADC->EVENTS_END = 1;
+    m_channel_ticks     = p_sample->ticks;
+    replay_adc_irq_handler();
+
+    // Same data path as adc_samples_process.
+    while (adc_ring_get(&m_ring, &raw))
+    {
+        if (adc_decimator_put(&m_decimator, raw, &filtered))
+        {
+            is_press |= sensor_pipeline_sample(&m_sensor, filtered, m_channel_ticks);
+        }
+    }
+    return is_press;
+}
+
+
+static bool trace_load(const char * p_path, replay_trace_t * p_trace)
+{
+    FILE *   p_file = fopen(p_path, "r");
+    char     line[128];
+    uint32_t capacity = 0;
+    unsigned ticks, raw, pressed;
+
+    if (p_file == NULL)
+    {
+        return false;
+    }
+    memset(p_trace, 0, sizeof(replay_trace_t));
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        if (line[0] == '#')
+        {
+            if (sscanf(line, "# expect detections=%u fp=%u fn=%u", &ticks, &raw, &pressed) == 3)
+            {
+                p_trace->has_expect        = true;
+                p_trace->expect_detections = ticks;
+                p_trace->expect_fp         = raw;
+                p_trace->expect_fn         = pressed;
+            }
+            continue;
+        }
+        if (sscanf(line, "%u,%u,%u", &ticks, &raw, &pressed) != 3)
+        {
+            continue;
+        }
+        if (p_trace->count == capacity)
+        {
+            capacity = (capacity == 0) ? 4096 : capacity * 2;
+            p_trace->p_samples = realloc(p_trace->p_samples, capacity * sizeof(replay_sample_t));
+            if (p_trace->p_samples == NULL)
+            {
+                fclose(p_file);
+                return false;
+            }
+        }
+        p_trace->p_samples[p_trace->count].ticks      = ticks;
+        p_trace->p_samples[p_trace->count].raw        = (uint16_t)raw;
+        p_trace->p_samples[p_trace->count].is_pressed = (pressed != 0);
+        p_trace->count++;
+    }
+    fclose(p_file);
+    return true;
+}
+
+
+static uint64_t time_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+/**@brief   Replays a trace and prints its report.
+ *
+ * @return  true if the trace gives no expected results or they were met.
+ */
+static bool trace_replay(const char * p_path, const replay_trace_t * p_trace, uint32_t repeat)
+{
+    uint32_t labelled = 0, detections = 0, fp = 0, fn = 0;
+    uint32_t latency_count = 0;
+    uint64_t latency_sum_us = 0, latency_max_us = 0;
+    uint32_t press_start = 0, press_end = 0;
+    bool     in_press = false, press_has_detection = false;
+    uint32_t tail_ticks = MS_TO_TICKS(REPLAY_MATCH_TAIL_MS);
+    uint64_t start_ns, elapsed_ns;
+#if REPLAY_HAS_TSC
+    uint64_t start_tsc, elapsed_tsc;
+#endif
+
+    replay_sensor_init();
+    for (uint32_t i = 0; i < p_trace->count; i++)
+    {
+        const replay_sample_t * p_sample = &p_trace->p_samples[i];
+        bool                    is_press = replay_conversion(p_sample);
+
+        if (p_sample->is_pressed && !in_press)
+        {
+            // The previous labelled press is over.
+            if ((labelled > 0) && !press_has_detection)
+            {
+                fn++;
+            }
+            labelled++;
+            in_press            = true;
+            press_has_detection = false;
+            press_start         = p_sample->ticks;
+        }
+        else if (!p_sample->is_pressed && in_press)
+        {
+            in_press  = false;
+            press_end = p_sample->ticks;
+        }
+
+        if (!is_press)
+        {
+            continue;
+        }
+        detections++;
+        if ((labelled > 0) && !press_has_detection &&
+            (in_press || (p_sample->ticks - press_end <= tail_ticks)))
+        {
+            uint64_t latency_us = TICKS_TO_US(p_sample->ticks - press_start);
+
+            press_has_detection = true;
+            latency_count++;
+            latency_sum_us += latency_us;
+            if (latency_us > latency_max_us)
+            {
+                latency_max_us = latency_us;
+            }
+        }
+        else
+        {
+            fp++;
+        }
+    }
+    if ((labelled > 0) && !press_has_detection)
+    {
+        fn++;
+    }
+
+    // Timing only, the results of the repeated runs are the same.
+    replay_sensor_init();
+    start_ns = time_ns();
+#if REPLAY_HAS_TSC
+    start_tsc = __rdtsc();
+#endif
+    for (uint32_t r = 0; r < repeat; r++)
+    {
+        for (uint32_t i = 0; i < p_trace->count; i++)
+        {
+            (void)replay_conversion(&p_trace->p_samples[i]);
+        }
+    }
+#if REPLAY_HAS_TSC
+    elapsed_tsc = __rdtsc() - start_tsc;
+#endif
+    elapsed_ns = time_ns() - start_ns;
+
+    printf("%s\n", p_path);
+    printf("  conversions %u, decimated samples %u, labelled presses %u\n",
+           p_trace->count, m_sensor.sample_count / repeat, labelled);
+    printf("  detections %u, false positives %u, false negatives %u\n", detections, fp, fn);
+    printf("  baseline restarts %u\n", m_sensor.reseed_count / repeat);
+    if (latency_count > 0)
+    {
+        printf("  latency from press start: mean %.1f ms, max %.1f ms\n",
+               latency_sum_us / 1000.0 / latency_count, latency_max_us / 1000.0);
+    }
+    printf("  host time per conversion: %.1f ns", (double)elapsed_ns / ((double)p_trace->count * repeat));
+#if REPLAY_HAS_TSC
+    printf(", %.1f TSC cycles", (double)elapsed_tsc / ((double)p_trace->count * repeat));
+#endif
+    printf("\n");
+
+    if (!p_trace->has_expect)
+    {
+        return true;
+    }
+    if ((detections != p_trace->expect_detections) || (fp != p_trace->expect_fp) || (fn != p_trace->expect_fn))
+    {
+        printf("  FAIL: expected detections %u, false positives %u, false negatives %u\n",
+               p_trace->expect_detections, p_trace->expect_fp, p_trace->expect_fn);
+        return false;
+    }
+    printf("  OK\n");
+    return true;
+}
+
+
+int main(int argc, char * argv[])
+{
+    replay_trace_t trace;
+    uint32_t       repeat = 100;
+    bool           is_ok  = true;
+    int            first  = 1;
+
+    if ((argc > 2) && (strcmp(argv[1], "-n") == 0))
+    {
+        repeat = (uint32_t)strtoul(argv[2], NULL, 0);
+        repeat = (repeat == 0) ? 1 : repeat;
+        first  = 3;
+    }
+    if (first >= argc)
+    {
+        fprintf(stderr, "usage: %s [-n repeat] trace.csv...\n", argv[0]);
+        return 2;
+    }
+    for (int i = first; i < argc; i++)
+    {
+        if (!trace_load(argv[i], &trace))
+        {
+            fprintf(stderr, "%s: cannot read trace\n", argv[i]);
+            return 2;
+        }
+        is_ok &= trace_replay(argv[i], &trace, repeat);
+        free(trace.p_samples);
+    }
+    return is_ok ? 0 : 1;
+}
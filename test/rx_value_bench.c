@@ -0,0 +1,150 @@
+/**@file
+ *
+ * @brief    Host benchmark of the received value path, before and after the fixed point rewrite.
+ *
+ * @details  The old path is the original nus_data_handler code: atoi, a double precision
+ *           accumulator and a linear scan of led_table for the LED level. The new path is
+ *           @ref rx_value_parse and RX_VALUE_TO_FILL added to a @ref fill_level_t, as the handler
+ *           and the actuator context run it now. Both are run over the same writes and their totals
+ *           are checked against each other, so the rewrite is also checked for accuracy.
+ *
+ *           The host has an FPU and a divider, so these times understate the cost of the old path
+ *           on the Cortex-M0, where it calls the soft-float and division library routines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+#include "rx_value.h"
+#include "fill_level.h"
+
+#define BENCH_ROUNDS                    200000                       /**< Passes over the writes for the timing. */
+#define BENCH_CAPACITY                  255                          /**< Fill level capacity, full LED brightness as in main.c. */
+
+static const uint8_t led_table[]   = {255, 254, 252, 250, 247, 244, 240, 236, 232, 227,  \
+                                      221, 216, 213, 210, 203, 197, 190, 182, 175, 168,  \
+                                      160, 152, 144, 136, 128, 120, 112, 104, 96,  91,   \
+                                      88,  81,  74,  66,  59,  53,  46,  40,  35,  29,   \
+                                      24,  20,  16,  12,  9,   6,   4,   2,   1,   0};
+
+/**@brief   Writes as sent by the app, null terminated only for the old path's atoi. */
+static const char * const m_writes[] = {"5", "12", "37", "120", "64", "999", "3", "250", "18", "7",
+                                        "45", "100", "1", "88", "640", "29", "11", "300", "9", "56"};
+
+#define BENCH_WRITE_COUNT               (sizeof(m_writes) / sizeof(m_writes[0]))
+
+static float        m_old_total;
+static uint8_t      m_old_pos;
+static fill_level_t m_new_fill;
+
+
+/**@brief   Original handler path: atoi, double precision accumulation, linear table scan. */
+static void old_path(const char * p_write)
+{
+    uint32_t val_rcvd_ble = atoi(p_write);
+
+    m_old_total += (float)val_rcvd_ble/10.0;
+    for (m_old_pos = 0; m_old_pos < 49; m_old_pos++)
+    {
+        if (led_table[m_old_pos] <= m_old_total)
+        {
+            break;
+        }
+    }
+}
+
+
+/**@brief   Current path: bounded parse, fixed point scaling, saturating fill level. */
+static void new_path(const char * p_write)
+{
+    uint32_t val_rcvd_ble = rx_value_parse((const uint8_t *)p_write, (uint16_t)strlen(p_write));
+
+    (void)fill_level_add(&m_new_fill, RX_VALUE_TO_FILL(val_rcvd_ble), 0);
+}
+
+
+static void paths_reset(void)
+{
+    fill_level_config_t config = {.capacity = (uint32_t)BENCH_CAPACITY << FILL_LEVEL_FRAC_BITS, .decay_rate = 0};
+
+    m_old_total = 0;
+    m_old_pos   = 0;
+    fill_level_init(&m_new_fill, &config, 0);
+}
+
+
+static uint64_t time_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+/**@brief   Checks that the new path accumulates the same total as the old one.
+ *
+ * @details RX_VALUE_TO_FILL is within one 1/256 unit of a tenth of the value, so after n writes
+ *          the totals may differ by n/256. The old total is not limited, the new one saturates at
+ *          the capacity.
+ */
+static bool accuracy_check(void)
+{
+    bool is_ok = true;
+
+    paths_reset();
+    for (uint32_t i = 0; i < BENCH_WRITE_COUNT; i++)
+    {
+        double old_total, new_total, tolerance = (i + 1) / 256.0;
+
+        old_path(m_writes[i]);
+        new_path(m_writes[i]);
+        old_total = (m_old_total > BENCH_CAPACITY) ? BENCH_CAPACITY : m_old_total;
+        new_total = (double)m_new_fill.level / (1 << FILL_LEVEL_FRAC_BITS);
+        if (fabs(new_total - old_total) > tolerance)
+        {
+            printf("  write %u \"%s\": old total %.3f, new total %.3f\n", i, m_writes[i], old_total, new_total);
+            is_ok = false;
+        }
+    }
+    return is_ok;
+}
+
+
+static double path_time_ns(void (*path)(const char *))
+{
+    uint64_t start_ns;
+
+    start_ns = time_ns();
+    for (uint32_t r = 0; r < BENCH_ROUNDS; r++)
+    {
+        // The totals are restarted every pass, so both paths see the same range of levels.
+        paths_reset();
+        for (uint32_t i = 0; i < BENCH_WRITE_COUNT; i++)
+        {
+            path(m_writes[i]);
+        }
+    }
+    return (double)(time_ns() - start_ns) / ((double)BENCH_ROUNDS * BENCH_WRITE_COUNT);
+}
+
+
+int main(void)
+{
+    double old_ns, new_ns;
+    bool   is_ok = accuracy_check();
+
+    old_ns = path_time_ns(old_path);
+    new_ns = path_time_ns(new_path);
+
+    printf("received value path, host time per write\n");
+    printf("  old (atoi, double, table scan): %.1f ns\n", old_ns);
+    printf("  new (parse, fixed point):       %.1f ns\n", new_ns);
+    printf("  new / old: %.2f\n", new_ns / old_ns);
+    printf("  totals %s\n", is_ok ? "match" : "DIFFER");
+    return is_ok ? 0 : 1;
+}